@@ -0,0 +1,85 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings &settings)
+	: settings(settings), scale(settings.maxScale)
+{
+}
+
+bool DynamicResolution::update(double gpuFrameTime)
+{
+	if (averageFrameTime == 0.0) {
+		averageFrameTime = gpuFrameTime;
+	} else {
+		averageFrameTime += (gpuFrameTime - averageFrameTime) * settings.smoothing;
+	}
+
+	// Frames that were already in flight when the scale changed still report the old cost
+	if (cooldown > 0) {
+		--cooldown;
+		return false;
+	}
+
+	double budget = settings.targetFrameTime;
+
+	if (averageFrameTime > budget * settings.upperThreshold) {
+		framesUnderBudget = 0;
+		if (++framesOverBudget < settings.framesToDecrease) {
+			return false;
+		}
+
+		// Aim for the middle of the dead band, going by cost being proportional to the pixel count
+		double targetTime = budget * (settings.upperThreshold + settings.lowerThreshold) * 0.5;
+		float fitScale = scale * static_cast<float>(std::sqrt(targetTime / averageFrameTime));
+		return setScale(std::min(fitScale, scale - settings.scaleStep));
+	}
+	else if (averageFrameTime < budget * settings.lowerThreshold) {
+		framesOverBudget = 0;
+		if (++framesUnderBudget < settings.framesToIncrease) {
+			return false;
+		}
+
+		return setScale(scale + settings.scaleStep);
+	}
+	else {
+		framesOverBudget = 0;
+		framesUnderBudget = 0;
+		return false;
+	}
+}
+
+VkExtent2D DynamicResolution::getMaxExtent(VkExtent2D outputExtent) const
+{
+	return scaleExtent(outputExtent, settings.maxScale);
+}
+
+VkExtent2D DynamicResolution::getRenderExtent(VkExtent2D outputExtent) const
+{
+	return scaleExtent(outputExtent, scale);
+}
+
+bool DynamicResolution::setScale(float newScale)
+{
+	float previousScale = scale;
+	scale = std::clamp(newScale, settings.minScale, settings.maxScale);
+
+	framesOverBudget = 0;
+	framesUnderBudget = 0;
+
+	if (scale == previousScale) {
+		return false;
+	}
+
+	cooldown = settings.cooldownFrames;
+	return true;
+}
+
+VkExtent2D DynamicResolution::scaleExtent(VkExtent2D extent, float scale)
+{
+	VkExtent2D scaled;
+	scaled.width = std::max(static_cast<uint32_t>(std::ceil(extent.width * scale)), 1u);
+	scaled.height = std::max(static_cast<uint32_t>(std::ceil(extent.height * scale)), 1u);
+	return scaled;
+}
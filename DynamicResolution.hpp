@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+struct DynamicResolutionSettings {
+	double targetFrameTime = 1000.0 / 60.0; // GPU budget in milliseconds
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	float scaleStep = 0.05f; // Scale is only ever increased by this much at a time
+
+	// Dead band around the budget in which the scale is left alone, keeps it from oscillating
+	double upperThreshold = 0.95; // Fraction of the budget above which resolution is lowered
+	double lowerThreshold = 0.75; // Fraction of the budget below which resolution is raised
+
+	uint32_t framesToDecrease = 3; // Consecutive frames over the upper threshold before lowering
+	uint32_t framesToIncrease = 30; // Consecutive frames under the lower threshold before raising
+	uint32_t cooldownFrames = 4; // Frames ignored after a change, results lag behind by the frames in flight
+	double smoothing = 0.2; // Weight of the newest sample in the moving average
+};
+
+/*
+* Picks the resolution the scene is rendered at from the measured GPU frame time
+* The scale applies to both axes, GPU time is assumed to be roughly proportional to the pixel count, so scale squared
+* - Over budget, the scale drops straight to what should fit the budget
+* - Well under budget, the scale creeps back up by scaleStep
+* Lowering reacts within a few frames to avoid dropped frames, raising is slow so a single cheap frame doesn't cause a spike
+*/
+class DynamicResolution
+{
+public:
+	DynamicResolution(const DynamicResolutionSettings &settings = {});
+
+	// Feeds the GPU time of a finished frame, returns true when the scale changed
+	bool update(double gpuFrameTime);
+
+	float getScale() const { return scale; }
+	double getAverageFrameTime() const { return averageFrameTime; }
+	const DynamicResolutionSettings &getSettings() const { return settings; }
+
+	// Largest extent getRenderExtent can return, what the render target has to be allocated with
+	VkExtent2D getMaxExtent(VkExtent2D outputExtent) const;
+	VkExtent2D getRenderExtent(VkExtent2D outputExtent) const;
+
+private:
+	DynamicResolutionSettings settings;
+	float scale;
+	double averageFrameTime = 0.0;
+	uint32_t framesOverBudget = 0;
+	uint32_t framesUnderBudget = 0;
+	uint32_t cooldown = 0;
+
+	bool setScale(float newScale); // Returns false if clamping left the scale unchanged
+	static VkExtent2D scaleExtent(VkExtent2D extent, float scale);
+};
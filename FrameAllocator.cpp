@@ -0,0 +1,138 @@
+#include "FrameAllocator.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void FrameAllocator::create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, VkDeviceSize bytesPerFrame, bool enableDeviceAddress, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	minUniformAlignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+	minStorageAlignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, 1);
+
+	// Keep every frame's region aligned so offsets within a region stay aligned to the buffer's start
+	VkDeviceSize regionAlignment = std::max(minUniformAlignment, minStorageAlignment);
+	this->bytesPerFrame = alignUp(bytesPerFrame, regionAlignment);
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = this->bytesPerFrame * frameCount;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+	if (enableDeviceAddress) {
+		bufferInfo.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	}
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, allocator, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create frame allocator buffer!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+	VkMemoryAllocateFlagsInfo allocFlagsInfo{};
+	allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+	allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = enableDeviceAddress ? &allocFlagsInfo : nullptr;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = chooseMemoryType(physicalDevice, memoryRequirements.memoryTypeBits);
+
+	if (vkAllocateMemory(device, &allocInfo, allocator, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate frame allocator memory!");
+	}
+
+	vkBindBufferMemory(device, buffer, memory, 0);
+
+	// Memory stays mapped for the lifetime of the allocator, mapping is not free and coherent memory doesn't need flushing
+	void *data;
+	vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+	mappedData = static_cast<uint8_t *>(data);
+
+	if (enableDeviceAddress) {
+		VkBufferDeviceAddressInfo addressInfo{};
+		addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		addressInfo.buffer = buffer;
+		bufferAddress = vkGetBufferDeviceAddress(device, &addressInfo);
+	}
+}
+
+void FrameAllocator::destroy()
+{
+	if (memory != VK_NULL_HANDLE) {
+		vkUnmapMemory(device, memory);
+	}
+
+	vkDestroyBuffer(device, buffer, allocator);
+	vkFreeMemory(device, memory, allocator);
+
+	buffer = VK_NULL_HANDLE;
+	memory = VK_NULL_HANDLE;
+	mappedData = nullptr;
+}
+
+void FrameAllocator::beginFrame(uint32_t frameIndex)
+{
+	frameStart = bytesPerFrame * frameIndex;
+	head = 0;
+}
+
+FrameAllocation FrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	VkDeviceSize offset = alignUp(head, std::max<VkDeviceSize>(alignment, 1));
+
+	if (offset + size > bytesPerFrame) {
+		throw std::runtime_error("frame allocator ran out of memory for this frame!");
+	}
+
+	head = offset + size;
+	peakUsage = std::max(peakUsage, head);
+
+	FrameAllocation allocation;
+	allocation.buffer = buffer;
+	allocation.offset = frameStart + offset;
+	allocation.size = size;
+	allocation.data = mappedData + allocation.offset;
+	allocation.deviceAddress = bufferAddress != 0 ? bufferAddress + allocation.offset : 0;
+
+	return allocation;
+}
+
+FrameAllocation FrameAllocator::allocateUniform(VkDeviceSize size)
+{
+	return allocate(size, minUniformAlignment);
+}
+
+FrameAllocation FrameAllocator::allocateStorage(VkDeviceSize size)
+{
+	return allocate(size, minStorageAlignment);
+}
+
+FrameAllocation FrameAllocator::upload(const void *data, VkDeviceSize size, VkDeviceSize alignment)
+{
+	FrameAllocation allocation = allocate(size, alignment);
+	memcpy(allocation.data, data, static_cast<size_t>(size));
+	return allocation;
+}
+
+// Prefer memory that is both device local and host visible (resizable BAR) so the GPU reads it at full speed
+// Otherwise fall back to plain host visible memory which every device provides
+uint32_t FrameAllocator::chooseMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter)
+{
+	VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	try {
+		return findMemoryType(physicalDevice, typeFilter, hostVisible | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+	catch (const std::runtime_error &) {
+		return findMemoryType(physicalDevice, typeFilter, hostVisible);
+	}
+}
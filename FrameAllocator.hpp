@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+// A sub-range of the frame allocator's buffer, only valid until the frame slot it was allocated from is reused
+struct FrameAllocation {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0; // Used as the dynamic offset or vertex/index/indirect buffer offset
+	VkDeviceSize size = 0;
+	void *data = nullptr; // CPU pointer to write into, memory is persistently mapped and coherent
+	VkDeviceAddress deviceAddress = 0; // 0 if buffer device address is not enabled
+};
+
+/*
+* Linear (bump) allocator for data that only lives for a single frame, e.g. uniforms, dynamic vertices and indirect arguments
+* One buffer is created and split into a region per frame in flight, allocating is simply moving an offset forward
+* Once a frame has finished on the GPU its region is free again and can be reset as a whole with beginFrame()
+* This avoids creating buffers, mapping memory and writing descriptors for every draw
+*
+* Not thread safe, each recording thread should use its own allocator
+*/
+class FrameAllocator
+{
+public:
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, VkDeviceSize bytesPerFrame, bool enableDeviceAddress, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+
+	// Must only be called once the frame that last used this slot has finished on the GPU
+	void beginFrame(uint32_t frameIndex);
+
+	FrameAllocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+	FrameAllocation allocateUniform(VkDeviceSize size); // Respects minUniformBufferOffsetAlignment
+	FrameAllocation allocateStorage(VkDeviceSize size); // Respects minStorageBufferOffsetAlignment
+	FrameAllocation upload(const void *data, VkDeviceSize size, VkDeviceSize alignment);
+
+	VkBuffer getBuffer() const { return buffer; }
+	VkDeviceSize getPeakUsage() const { return peakUsage; }
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	uint8_t *mappedData = nullptr;
+	VkDeviceAddress bufferAddress = 0;
+
+	VkDeviceSize bytesPerFrame = 0;
+	VkDeviceSize frameStart = 0;
+	VkDeviceSize head = 0; // Offset of the next free byte, relative to frameStart
+	VkDeviceSize peakUsage = 0;
+
+	VkDeviceSize minUniformAlignment = 1;
+	VkDeviceSize minStorageAlignment = 1;
+
+	uint32_t chooseMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter);
+};
@@ -0,0 +1,302 @@
+#include "FrameCapture.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+void FrameCapture::create(VkDevice device, VkPhysicalDevice physicalDevice, SubmissionScheduler &scheduler, const std::string &outputPath,
+	OutputFormat outputFormat, VkExtent2D extent, VkFormat format, uint32_t ringSize, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+	this->scheduler = &scheduler;
+	this->outputPath = outputPath;
+	this->outputFormat = outputFormat;
+	this->extent = extent;
+
+	// Only 8 bit 4 channel formats are supported, the copy is a straight memcpy of the texels
+	switch (format) {
+	case VK_FORMAT_B8G8R8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+		swizzleBGR = true;
+		break;
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_R8G8B8A8_UNORM:
+		swizzleBGR = false;
+		break;
+	default:
+		throw std::runtime_error("frame capture doesn't support the image format!");
+	}
+
+	frameSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+	workers = std::make_unique<ThreadPool>(WORKER_COUNT);
+
+	std::filesystem::create_directories(outputPath);
+
+	if (outputFormat == OutputFormat::Y4mStream) {
+		stream.open(std::filesystem::path(outputPath) / "capture.y4m", std::ios::binary | std::ios::trunc);
+		if (!stream.is_open()) {
+			throw std::runtime_error("failed to open capture stream!");
+		}
+
+		// C444 keeps full resolution chroma so the frames stay comparable pixel for pixel
+		stream << "YUV4MPEG2 W" << extent.width << " H" << extent.height << " F60:1 Ip A1:1 C444\n";
+	}
+
+	for (uint32_t i = 0; i < ringSize; ++i) {
+		auto slot = std::make_unique<Slot>();
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = frameSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(device, &bufferInfo, allocator, &slot->buffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create capture buffer!");
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetBufferMemoryRequirements(device, slot->buffer, &memoryRequirements);
+
+		// The CPU reads every byte, cached memory makes those reads a lot faster than write-combined memory
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memoryRequirements.size;
+		try {
+			allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		}
+		catch (const std::runtime_error &) {
+			allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		}
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		memoryCoherent = (memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+		if (vkAllocateMemory(device, &allocInfo, allocator, &slot->memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate capture buffer memory!");
+		}
+
+		vkBindBufferMemory(device, slot->buffer, slot->memory, 0);
+
+		void *data;
+		vkMapMemory(device, slot->memory, 0, VK_WHOLE_SIZE, 0, &data);
+		slot->data = static_cast<const uint8_t *>(data);
+
+		slots.push_back(std::move(slot));
+	}
+}
+
+void FrameCapture::destroy()
+{
+	collect();
+
+	for (std::future<void> &write : pendingWrites) {
+		write.wait();
+	}
+	pendingWrites.clear();
+	workers.reset();
+
+	for (auto &slot : slots) {
+		vkUnmapMemory(device, slot->memory);
+		vkDestroyBuffer(device, slot->buffer, allocator);
+		vkFreeMemory(device, slot->memory, allocator);
+	}
+	slots.clear();
+
+	if (stream.is_open()) {
+		stream.close();
+	}
+
+	std::cout << "frame capture: " << capturedCount << " frames written, " << droppedCount << " dropped" << std::endl;
+}
+
+bool FrameCapture::recordCopy(VkCommandBuffer commandBuffer, VkImage image, const TimelinePoint &completion)
+{
+	auto it = std::find_if(slots.begin(), slots.end(), [](const std::unique_ptr<Slot> &slot) { return slot->state == SlotState::Free; });
+
+	// Waiting for a slot would stall rendering, losing a frame is the lesser evil
+	if (it == slots.end()) {
+		++droppedCount;
+		return false;
+	}
+
+	Slot &slot = **it;
+	slot.completion = completion;
+	slot.sequence = nextSequence++;
+	slot.state = SlotState::Copying;
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0; // Tightly packed
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { extent.width, extent.height, 1 };
+
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+	// Makes the copied data visible to the host once the timeline has reached the completion point
+	VkBufferMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = slot.buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = 1;
+	dependencyInfo.pBufferMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	return true;
+}
+
+void FrameCapture::collect()
+{
+	// Forget writes that have already finished
+	pendingWrites.erase(std::remove_if(pendingWrites.begin(), pendingWrites.end(), [](const std::future<void> &write) {
+		return write.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}), pendingWrites.end());
+
+	// Hand slots over in the order they were recorded, which keeps the worker threads roughly in order as well
+	std::vector<Slot *> ready;
+	for (auto &slot : slots) {
+		if (slot->state == SlotState::Copying && scheduler->isReached(slot->completion)) {
+			ready.push_back(slot.get());
+		}
+	}
+	std::sort(ready.begin(), ready.end(), [](const Slot *a, const Slot *b) { return a->sequence < b->sequence; });
+
+	for (Slot *slot : ready) {
+		if (!memoryCoherent) {
+			VkMappedMemoryRange range{};
+			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range.memory = slot->memory;
+			range.offset = 0;
+			range.size = VK_WHOLE_SIZE;
+			vkInvalidateMappedMemoryRanges(device, 1, &range);
+		}
+
+		slot->state = SlotState::Writing;
+		pendingWrites.push_back(workers->submit([this, slot]() { writeFrame(*slot); }));
+	}
+}
+
+void FrameCapture::writeFrame(Slot &slot)
+{
+	try {
+		if (outputFormat == OutputFormat::PpmSequence) {
+			writePpm(slot);
+		} else {
+			writeY4mFrame(slot);
+		}
+	}
+	catch (const std::exception &e) {
+		std::cerr << "frame capture: " << e.what() << std::endl;
+	}
+
+	slot.state = SlotState::Free;
+}
+
+// Binary PPM, a small text header followed by tightly packed 8 bit RGB
+void FrameCapture::writePpm(const Slot &slot)
+{
+	char filename[32];
+	snprintf(filename, sizeof(filename), "frame_%06llu.ppm", static_cast<unsigned long long>(slot.sequence));
+
+	std::vector<uint8_t> rgb(static_cast<size_t>(extent.width) * extent.height * 3);
+	for (size_t i = 0, pixels = rgb.size() / 3; i < pixels; ++i) {
+		const uint8_t *texel = slot.data + i * 4;
+		rgb[i * 3 + 0] = swizzleBGR ? texel[2] : texel[0];
+		rgb[i * 3 + 1] = texel[1];
+		rgb[i * 3 + 2] = swizzleBGR ? texel[0] : texel[2];
+	}
+
+	std::ofstream file(std::filesystem::path(outputPath) / filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open capture file!");
+	}
+
+	file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+	file.write(reinterpret_cast<const char *>(rgb.data()), rgb.size());
+	file.close();
+	if (!file) {
+		throw std::runtime_error("failed to write capture file!");
+	}
+	++capturedCount;
+}
+
+// Frames are converted in parallel but appended to the stream in the order they were recorded
+void FrameCapture::writeY4mFrame(const Slot &slot)
+{
+	// Whatever goes wrong with this frame, the stream has to move on past it, otherwise every later worker waits forever
+	std::vector<uint8_t> planes;
+	std::exception_ptr error;
+	try {
+		planes = convertToYuv(slot);
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+
+	std::unique_lock<std::mutex> lock(streamMutex);
+	streamCondition.wait(lock, [&]() { return nextSequenceToWrite == slot.sequence; });
+
+	if (!error) {
+		stream << "FRAME\n";
+		stream.write(reinterpret_cast<const char *>(planes.data()), planes.size());
+		if (stream) {
+			++capturedCount;
+		} else {
+			error = std::make_exception_ptr(std::runtime_error("failed to write capture stream!"));
+		}
+	}
+	++nextSequenceToWrite;
+
+	lock.unlock();
+	streamCondition.notify_all();
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+// Y4M frames are planar, all of Y, then U, then V, converted with BT.601 full range coefficients
+std::vector<uint8_t> FrameCapture::convertToYuv(const Slot &slot) const
+{
+	size_t pixels = static_cast<size_t>(extent.width) * extent.height;
+	std::vector<uint8_t> planes(pixels * 3);
+
+	for (size_t i = 0; i < pixels; ++i) {
+		const uint8_t *texel = slot.data + i * 4;
+		float r = swizzleBGR ? texel[2] : texel[0];
+		float g = texel[1];
+		float b = swizzleBGR ? texel[0] : texel[2];
+
+		float y = 0.299f * r + 0.587f * g + 0.114f * b;
+		float u = 128.0f + (b - y) * 0.564f;
+		float v = 128.0f + (r - y) * 0.713f;
+
+		planes[i] = static_cast<uint8_t>(std::clamp(y, 0.0f, 255.0f));
+		planes[pixels + i] = static_cast<uint8_t>(std::clamp(u, 0.0f, 255.0f));
+		planes[pixels * 2 + i] = static_cast<uint8_t>(std::clamp(v, 0.0f, 255.0f));
+	}
+
+	return planes;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+#include "ThreadPool.hpp"
+#include "SubmissionScheduler.hpp"
+
+/*
+* Records rendered images to disk without stalling rendering
+* - recordCopy() adds a copy of the image into one of a ring of host visible readback buffers to the frame's command buffer
+* - collect() polls the timeline points of earlier frames, it never waits on them
+* - Finished copies are converted and written to disk by worker threads of its own, so a slow disk never holds up jobs the frame is waiting on
+* If every readback buffer is still busy the frame is dropped rather than waiting, see getDroppedCount()
+*
+* Works with any image that has VK_IMAGE_USAGE_TRANSFER_SRC_BIT, swap chain images or offscreen targets alike
+*/
+class FrameCapture
+{
+public:
+	enum class OutputFormat {
+		PpmSequence, // One binary PPM file per frame
+		Y4mStream // A single uncompressed YUV 4:4:4 video stream
+	};
+
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, SubmissionScheduler &scheduler, const std::string &outputPath,
+		OutputFormat outputFormat, VkExtent2D extent, VkFormat format, uint32_t ringSize, const VkAllocationCallbacks *allocator = nullptr);
+	// The device has to be idle, every finished copy is still written out before returning
+	void destroy();
+
+	// The image has to be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, completion is the point the command buffer's batch signals
+	bool recordCopy(VkCommandBuffer commandBuffer, VkImage image, const TimelinePoint &completion);
+
+	// Called once per frame, timeline values never get reused so it doesn't matter when
+	void collect();
+
+	uint64_t getCapturedCount() const { return capturedCount; }
+	uint64_t getDroppedCount() const { return droppedCount; }
+
+private:
+	enum class SlotState {
+		Free,
+		Copying, // Copy recorded, waiting for the GPU
+		Writing // Handed to a worker thread
+	};
+
+	struct Slot {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		const uint8_t *data = nullptr;
+		TimelinePoint completion;
+		uint64_t sequence = 0;
+		std::atomic<SlotState> state{ SlotState::Free };
+	};
+
+	// Conversion is cheap next to the file writes, a couple of threads keep up with the ring
+	static const uint32_t WORKER_COUNT = 2;
+
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	std::unique_ptr<ThreadPool> workers;
+	SubmissionScheduler *scheduler = nullptr;
+	std::string outputPath;
+	OutputFormat outputFormat = OutputFormat::PpmSequence;
+	VkExtent2D extent{};
+	bool swizzleBGR = false;
+	bool memoryCoherent = true;
+	VkDeviceSize frameSize = 0;
+
+	std::vector<std::unique_ptr<Slot>> slots; // unique_ptr because atomics can't be moved
+	std::vector<std::future<void>> pendingWrites;
+	uint64_t nextSequence = 0;
+	std::atomic<uint64_t> capturedCount{ 0 }; // Incremented by worker threads
+	uint64_t droppedCount = 0;
+
+	// Frames of a video stream have to be written in order, even though they are converted in parallel
+	std::ofstream stream;
+	std::mutex streamMutex;
+	std::condition_variable streamCondition;
+	uint64_t nextSequenceToWrite = 0;
+
+	void writeFrame(Slot &slot);
+	void writePpm(const Slot &slot);
+	void writeY4mFrame(const Slot &slot);
+	std::vector<uint8_t> convertToYuv(const Slot &slot) const;
+};
@@ -0,0 +1,168 @@
+#include "GpuTimer.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+void GpuTimer::create(VkDevice device, VkPhysicalDevice physicalDevice, const std::vector<uint32_t> &queueFamilyIndices, uint32_t frameCount, uint32_t maxScopesPerFrame, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+	this->maxScopesPerFrame = maxScopesPerFrame;
+	frameScopes.resize(frameCount);
+	timestamps.resize(maxScopesPerFrame * 2);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	// A queue family without valid bits can't write timestamps at all, the timer then simply reports nothing
+	uint32_t validBits = 64;
+	for (uint32_t queueFamilyIndex : queueFamilyIndices) {
+		validBits = std::min(validBits, queueFamilies[queueFamilyIndex].timestampValidBits);
+	}
+	supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+	if (!supported) {
+		return;
+	}
+
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = frameCount * maxScopesPerFrame * 2;
+
+	if (vkCreateQueryPool(device, &queryPoolInfo, allocator, &queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+}
+
+void GpuTimer::destroy()
+{
+	if (queryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device, queryPool, allocator);
+		queryPool = VK_NULL_HANDLE;
+	}
+}
+
+void GpuTimer::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	currentFrame = frameIndex;
+	if (!supported) {
+		return;
+	}
+
+	readResults(frameIndex);
+	frameScopes[frameIndex].clear();
+
+	// Queries have to be reset before they are written again, outside of any rendering
+	vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery(frameIndex), maxScopesPerFrame * 2);
+}
+
+uint32_t GpuTimer::beginScope(VkCommandBuffer commandBuffer, const std::string &name)
+{
+	std::vector<std::string> &scopes = frameScopes[currentFrame];
+	if (!supported || scopes.size() >= maxScopesPerFrame) {
+		return INVALID_SCOPE;
+	}
+
+	uint32_t scope = static_cast<uint32_t>(scopes.size());
+	scopes.push_back(name);
+
+	// Written once every previous command has finished, the end timestamp once every command of the scope has finished
+	// At ALL_COMMANDS the write is also in the second scope of every barrier and semaphore wait before it, so it waits for them
+	// TOP_OF_PIPE could be written while the scope is still blocked, counting e.g. the wait for the swap chain image
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, firstQuery(currentFrame) + scope * 2);
+	return scope;
+}
+
+void GpuTimer::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+	if (scope == INVALID_SCOPE) {
+		return;
+	}
+
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, queryPool, firstQuery(currentFrame) + scope * 2 + 1);
+}
+
+double GpuTimer::getMilliseconds(const std::string &name) const
+{
+	for (const ScopeResult &result : results) {
+		if (result.name == name) {
+			return result.milliseconds;
+		}
+	}
+	return -1.0;
+}
+
+double GpuTimer::getTotalMilliseconds() const
+{
+	if (results.empty()) {
+		return -1.0;
+	}
+
+	double total = 0.0;
+	for (const ScopeResult &result : results) {
+		total += result.milliseconds;
+	}
+	return total;
+}
+
+void GpuTimer::readResults(uint32_t frameIndex)
+{
+	const std::vector<std::string> &scopes = frameScopes[frameIndex];
+
+	// Nothing was recorded in this slot yet, its queries have never been reset so they can't be read
+	if (scopes.empty()) {
+		return;
+	}
+
+	// The frame has finished on the GPU, so the results are available and this doesn't wait
+	uint32_t queryCount = static_cast<uint32_t>(scopes.size()) * 2;
+	VkResult result = vkGetQueryPoolResults(device, queryPool, firstQuery(frameIndex), queryCount,
+		queryCount * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	results.clear();
+	for (size_t i = 0; i < scopes.size(); ++i) {
+		uint64_t begin = timestamps[i * 2] & timestampMask;
+		uint64_t end = timestamps[i * 2 + 1] & timestampMask;
+		uint64_t ticks = (end - begin) & timestampMask; // Handles the counter wrapping around
+
+		double milliseconds = ticks * timestampPeriod / 1000000.0;
+		results.push_back({ scopes[i], milliseconds });
+
+		ScopeTotals &total = totals[scopes[i]];
+		total.sum += milliseconds;
+		total.max = std::max(total.max, milliseconds);
+		++total.count;
+	}
+}
+
+void GpuTimer::printReport() const
+{
+	if (totals.empty()) {
+		return;
+	}
+
+	// Formatted on its own stream so the precision doesn't stick to std::cout
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(3);
+	report << "gpu timings (ms), average and max:\n";
+
+	for (const auto &[name, total] : totals) {
+		report << "  " << std::setw(8) << total.sum / total.count << "  " << std::setw(8) << total.max << "  " << name << "\n";
+	}
+
+	std::cout << report.str() << std::flush;
+}
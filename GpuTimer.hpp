@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+/*
+* Measures GPU time of parts of a frame with timestamp queries
+* Every frame in flight owns its own range of queries, results are read back once that frame has finished on the GPU
+* so reading them never stalls, at the cost of the results being MAX_FRAMES_IN_FLIGHT frames old
+*
+* Scopes are named, begin/end pairs are written with vkCmdWriteTimestamp2 around the commands to measure
+* A scope has to begin and end on the same queue, timestamps of different queues aren't comparable
+* A scope only starts once the commands and waits before it are done, so time blocked on a semaphore or barrier,
+* e.g. for the swap chain image to be released by presentation, is never counted
+*/
+class GpuTimer
+{
+public:
+	struct ScopeResult {
+		std::string name;
+		double milliseconds = 0.0;
+	};
+
+	static const uint32_t INVALID_SCOPE = ~0u;
+
+	// Timestamps are only supported if every queue family that writes them supports them
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, const std::vector<uint32_t> &queueFamilyIndices, uint32_t frameCount, uint32_t maxScopesPerFrame, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+
+	// Must be called at the start of the frame's command buffer, after waiting for the frame slot's previous use to finish
+	// Reads back what this frame slot measured last time and resets its queries
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Returns INVALID_SCOPE if timestamps are not supported or the frame ran out of scopes, endScope ignores it
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string &name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+	bool isSupported() const { return supported; }
+
+	// Results of the most recently read back frame, in the order the scopes were begun
+	const std::vector<ScopeResult> &getResults() const { return results; }
+	// Negative if the scope wasn't measured in that frame
+	double getMilliseconds(const std::string &name) const;
+	// Sum of every scope of the most recently read back frame, negative if nothing was measured
+	// The time the GPU was busy with the measured work, idle gaps between scopes and queues are left out
+	double getTotalMilliseconds() const;
+	// Average and maximum of every scope over the whole run
+	void printReport() const;
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	bool supported = false;
+	double timestampPeriod = 1.0; // Nanoseconds per tick
+	uint64_t timestampMask = ~0ull; // Only timestampValidBits of a timestamp are meaningful
+
+	uint32_t maxScopesPerFrame = 0;
+	uint32_t currentFrame = 0;
+	std::vector<std::vector<std::string>> frameScopes; // Names of the scopes each frame slot recorded
+	std::vector<uint64_t> timestamps;
+	std::vector<ScopeResult> results;
+
+	struct ScopeTotals {
+		double sum = 0.0;
+		double max = 0.0;
+		uint64_t count = 0;
+	};
+	std::map<std::string, ScopeTotals> totals; // Ordered so the report is stable
+
+	uint32_t firstQuery(uint32_t frameIndex) const { return frameIndex * maxScopesPerFrame * 2; }
+	void readResults(uint32_t frameIndex);
+};
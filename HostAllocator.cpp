@@ -0,0 +1,243 @@
+#include "HostAllocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Bump allocator owned by one thread, frees only count down until the whole arena can be reused
+struct HostAllocator::Arena {
+	char *memory = nullptr;
+	size_t offset = 0;
+	std::atomic<uint32_t> outstanding{ 0 }; // Driver threads may free what was allocated on another thread
+
+	Arena() : memory(static_cast<char *>(std::malloc(ARENA_SIZE))) {}
+	~Arena() { std::free(memory); }
+
+	void *allocate(size_t size, size_t alignment) {
+		// Nothing handed out is still in use, start from the beginning again
+		if (outstanding.load(std::memory_order_acquire) == 0) {
+			offset = 0;
+		}
+
+		uintptr_t start = reinterpret_cast<uintptr_t>(memory) + offset + sizeof(Header);
+		uintptr_t aligned = (start + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+		size_t end = static_cast<size_t>(aligned - reinterpret_cast<uintptr_t>(memory)) + size;
+
+		if (memory == nullptr || end > ARENA_SIZE) {
+			return nullptr;
+		}
+
+		offset = end;
+		outstanding.fetch_add(1, std::memory_order_relaxed);
+		return reinterpret_cast<void *>(aligned);
+	}
+};
+
+HostAllocator::HostAllocator()
+{
+	callbacks.pUserData = this;
+	callbacks.pfnAllocation = allocationCallback;
+	callbacks.pfnReallocation = reallocationCallback;
+	callbacks.pfnFree = freeCallback;
+	callbacks.pfnInternalAllocation = internalAllocationCallback;
+	callbacks.pfnInternalFree = internalFreeCallback;
+}
+
+void *HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (size == 0) {
+		return nullptr;
+	}
+
+	// The header in front has to be aligned as well, the requested alignment is always a power of two
+	alignment = std::max(alignment, alignof(Header));
+
+	void *memory = nullptr;
+	Header header{};
+	header.size = size;
+	header.scope = scope;
+
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+		// Deletes the thread's arena when the thread exits, unless the driver still holds on to something from it
+		// COMMAND scope allocations never outlive the call that made them, so that would be a driver bug and the arena is leaked instead
+		struct ThreadArena {
+			Arena *arena = nullptr;
+
+			~ThreadArena() {
+				if (arena != nullptr && arena->outstanding.load() == 0) {
+					delete arena;
+				}
+			}
+		};
+
+		thread_local ThreadArena threadArena;
+		if (threadArena.arena == nullptr) {
+			threadArena.arena = new Arena();
+		}
+
+		memory = threadArena.arena->allocate(size, alignment);
+		if (memory != nullptr) {
+			header.arena = threadArena.arena;
+			arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		else {
+			arenaFallbacks.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (memory == nullptr) {
+		void *base = std::malloc(size + alignment + sizeof(Header));
+		if (base == nullptr) {
+			return nullptr;
+		}
+
+		uintptr_t start = reinterpret_cast<uintptr_t>(base) + sizeof(Header);
+		memory = reinterpret_cast<void *>((start + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+		header.base = base;
+	}
+
+	std::memcpy(static_cast<char *>(memory) - sizeof(Header), &header, sizeof(Header));
+
+	Counters &counters = scopes[scope];
+	addLive(counters.liveBytes, counters.peakBytes, size);
+	counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+	addLive(total.liveBytes, total.peakBytes, size);
+	total.allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	return memory;
+}
+
+void *HostAllocator::reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (original == nullptr) {
+		return allocate(size, alignment, scope);
+	}
+	if (size == 0) {
+		free(original);
+		return nullptr;
+	}
+
+	Header header;
+	std::memcpy(&header, static_cast<char *>(original) - sizeof(Header), sizeof(Header));
+
+	// On failure the original allocation has to stay untouched
+	void *memory = allocate(size, alignment, scope);
+	if (memory == nullptr) {
+		return nullptr;
+	}
+
+	std::memcpy(memory, original, std::min(size, header.size));
+	free(original);
+	return memory;
+}
+
+void HostAllocator::free(void *memory)
+{
+	if (memory == nullptr) {
+		return;
+	}
+
+	Header header;
+	std::memcpy(&header, static_cast<char *>(memory) - sizeof(Header), sizeof(Header));
+
+	scopes[header.scope].liveBytes.fetch_sub(header.size, std::memory_order_relaxed);
+	total.liveBytes.fetch_sub(header.size, std::memory_order_relaxed);
+
+	if (header.arena != nullptr) {
+		header.arena->outstanding.fetch_sub(1, std::memory_order_release);
+	}
+	else {
+		std::free(header.base);
+	}
+}
+
+void HostAllocator::addLive(std::atomic<uint64_t> &live, std::atomic<uint64_t> &peak, uint64_t size)
+{
+	uint64_t current = live.fetch_add(size, std::memory_order_relaxed) + size;
+
+	uint64_t previousPeak = peak.load(std::memory_order_relaxed);
+	while (current > previousPeak && !peak.compare_exchange_weak(previousPeak, current, std::memory_order_relaxed)) {
+	}
+}
+
+HostAllocator::ScopeStats HostAllocator::getStats(VkSystemAllocationScope scope) const
+{
+	return loadStats(scopes[scope]);
+}
+
+HostAllocator::ScopeStats HostAllocator::getTotalStats() const
+{
+	return loadStats(total);
+}
+
+HostAllocator::ScopeStats HostAllocator::loadStats(const Counters &counters)
+{
+	ScopeStats stats;
+	stats.liveBytes = counters.liveBytes.load();
+	stats.peakBytes = counters.peakBytes.load();
+	stats.allocationCount = counters.allocationCount.load();
+	stats.internalLiveBytes = counters.internalLiveBytes.load();
+	stats.internalPeakBytes = counters.internalPeakBytes.load();
+	return stats;
+}
+
+void HostAllocator::printReport() const
+{
+	if (!enabled) {
+		return;
+	}
+
+	const char *scopeNames[SCOPE_COUNT] = { "command", "object", "cache", "device", "instance" };
+
+	std::cout << "host allocator:" << std::endl;
+	for (uint32_t scope = 0; scope < SCOPE_COUNT; ++scope) {
+		ScopeStats stats = getStats(static_cast<VkSystemAllocationScope>(scope));
+
+		std::cout << "  " << scopeNames[scope] << ": " << stats.allocationCount << " allocations, "
+			<< stats.liveBytes / 1024 << " KiB live, " << stats.peakBytes / 1024 << " KiB peak";
+		if (stats.internalPeakBytes > 0) {
+			std::cout << ", internal " << stats.internalLiveBytes / 1024 << " KiB live, " << stats.internalPeakBytes / 1024 << " KiB peak";
+		}
+		std::cout << std::endl;
+	}
+
+	ScopeStats totalStats = getTotalStats();
+	std::cout << "  total: " << totalStats.allocationCount << " allocations, "
+		<< totalStats.liveBytes / 1024 << " KiB live, " << totalStats.peakBytes / 1024 << " KiB peak" << std::endl;
+
+	uint64_t arenaTotal = arenaAllocations.load() + arenaFallbacks.load();
+	if (arenaTotal > 0) {
+		std::cout << "  command arena: " << arenaAllocations.load() << " of " << arenaTotal << " command allocations" << std::endl;
+	}
+}
+
+VKAPI_ATTR void *VKAPI_CALL HostAllocator::allocationCallback(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<HostAllocator *>(userData)->allocate(size, alignment, scope);
+}
+
+VKAPI_ATTR void *VKAPI_CALL HostAllocator::reallocationCallback(void *userData, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<HostAllocator *>(userData)->reallocate(original, size, alignment, scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::freeCallback(void *userData, void *memory)
+{
+	static_cast<HostAllocator *>(userData)->free(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalAllocationCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	HostAllocator *hostAllocator = static_cast<HostAllocator *>(userData);
+	Counters &counters = hostAllocator->scopes[scope];
+	addLive(counters.internalLiveBytes, counters.internalPeakBytes, size);
+	addLive(hostAllocator->total.internalLiveBytes, hostAllocator->total.internalPeakBytes, size);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalFreeCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	HostAllocator *hostAllocator = static_cast<HostAllocator *>(userData);
+	hostAllocator->scopes[scope].internalLiveBytes.fetch_sub(size, std::memory_order_relaxed);
+	hostAllocator->total.internalLiveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+/*
+* VkAllocationCallbacks for the host memory the driver allocates on our behalf
+* - COMMAND scope allocations only live for the duration of a single Vulkan call, they are bump allocated from a
+*   thread local arena that is reset once everything allocated from it was freed again, so calls made on several
+*   threads at once (pipeline builds, recording) don't contend on the global heap
+* - Everything else goes to the heap
+* - Every scope is tracked: live bytes, peak and number of allocations, including what the driver reports through the
+*   internal allocation notifications (e.g. executable memory for shaders), which doesn't go through these callbacks
+*
+* Objects created with the callbacks have to be destroyed with them, so getCallbacks() is passed to both
+* The address of the allocator is handed to the driver, it must not move and has to outlive the instance
+*/
+class HostAllocator
+{
+public:
+	struct ScopeStats {
+		uint64_t liveBytes = 0;
+		uint64_t peakBytes = 0;
+		uint64_t allocationCount = 0; // Since creation, reallocations count as one
+		uint64_t internalLiveBytes = 0; // Reported by the driver through the notification callbacks
+		uint64_t internalPeakBytes = 0;
+	};
+
+	static const size_t ARENA_SIZE = 256 * 1024; // Per thread, COMMAND scope allocations that don't fit fall back to the heap
+	static const uint32_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+	HostAllocator();
+	HostAllocator(const HostAllocator &) = delete;
+	HostAllocator &operator=(const HostAllocator &) = delete;
+
+	// nullptr while disabled, which is the driver's own allocator, has to be decided before the instance is created
+	const VkAllocationCallbacks *getCallbacks() const { return enabled ? &callbacks : nullptr; }
+	void setEnabled(bool enabled) { this->enabled = enabled; }
+
+	ScopeStats getStats(VkSystemAllocationScope scope) const;
+	// Over all scopes, the peak is of the sum and not the sum of the peaks, which are reached at different times
+	ScopeStats getTotalStats() const;
+	void printReport() const;
+
+private:
+	struct Arena;
+
+	// Stored right in front of every allocation, the callbacks for freeing and reallocating only get the pointer
+	struct Header {
+		void *base; // What was returned by malloc, nullptr if the allocation came from an arena
+		Arena *arena;
+		size_t size;
+		VkSystemAllocationScope scope;
+	};
+
+	struct Counters {
+		std::atomic<uint64_t> liveBytes{ 0 };
+		std::atomic<uint64_t> peakBytes{ 0 };
+		std::atomic<uint64_t> allocationCount{ 0 };
+		std::atomic<uint64_t> internalLiveBytes{ 0 };
+		std::atomic<uint64_t> internalPeakBytes{ 0 };
+	};
+
+	VkAllocationCallbacks callbacks{};
+	bool enabled = true;
+
+	Counters scopes[SCOPE_COUNT];
+	Counters total;
+	std::atomic<uint64_t> arenaAllocations{ 0 };
+	std::atomic<uint64_t> arenaFallbacks{ 0 }; // COMMAND scope allocations the arena had no room for
+
+	void *allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void *reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void free(void *memory);
+
+	static void addLive(std::atomic<uint64_t> &live, std::atomic<uint64_t> &peak, uint64_t size);
+	static ScopeStats loadStats(const Counters &counters);
+
+	static VKAPI_ATTR void *VKAPI_CALL allocationCallback(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void *VKAPI_CALL reallocationCallback(void *userData, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL freeCallback(void *userData, void *memory);
+	static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+};
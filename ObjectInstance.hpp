@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+// Placement of one object of the scene, every object draws the same mesh
+// Read by the vertex shader as a per-instance attribute and by the occlusion culling shader as a storage buffer
+struct ObjectInstance {
+	glm::vec4 positionScale; // xy in normalized device coordinates, z the depth, w a uniform scale of the mesh
+
+	// VK_VERTEX_INPUT_RATE_INSTANCE, the data advances once per instance instead of once per vertex
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(ObjectInstance);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	// Locations continue after the ones used by Vertex
+	static std::array<VkVertexInputAttributeDescription, 1> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 1> attributeDescriptions{};
+
+		attributeDescriptions[0].binding = 1;
+		attributeDescriptions[0].location = 2;
+		attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[0].offset = offsetof(ObjectInstance, positionScale);
+
+		return attributeDescriptions;
+	}
+};
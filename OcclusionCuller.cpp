@@ -0,0 +1,520 @@
+#include "OcclusionCuller.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+void OcclusionCuller::create(VkDevice device, VkPhysicalDevice physicalDevice, const OcclusionCullerShaders &shaders, VkPipelineCache pipelineCache,
+	VkExtent2D maxDepthExtent, uint32_t frameCount, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+	frameDraws.resize(frameCount);
+
+	createPyramid(physicalDevice, maxDepthExtent);
+	createPipelines(shaders, pipelineCache);
+
+	// Only ever read with texelFetch, the sampler is required by the descriptor type but never filters
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = static_cast<float>(levelCount);
+
+	if (vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion culling sampler!");
+	}
+}
+
+void OcclusionCuller::destroy()
+{
+	vkDestroyPipeline(device, buildPipeline, allocator);
+	vkDestroyPipeline(device, cullPipeline, allocator);
+	vkDestroyPipelineLayout(device, buildPipelineLayout, allocator);
+	vkDestroyPipelineLayout(device, cullPipelineLayout, allocator);
+	vkDestroyDescriptorPool(device, descriptorPool, allocator);
+	vkDestroyDescriptorSetLayout(device, buildSetLayout, allocator);
+	vkDestroyDescriptorSetLayout(device, cullSetLayout, allocator);
+	vkDestroySampler(device, sampler, allocator);
+
+	for (VkImageView view : levelViews) {
+		vkDestroyImageView(device, view, allocator);
+	}
+	levelViews.clear();
+	vkDestroyImageView(device, pyramidView, allocator);
+	vkDestroyImage(device, pyramid, allocator);
+	vkFreeMemory(device, pyramidMemory, allocator);
+
+	buildSets.clear();
+	frameDraws.clear();
+}
+
+void OcclusionCuller::createPyramid(VkPhysicalDevice physicalDevice, VkExtent2D maxDepthExtent)
+{
+	pyramidExtent = levelExtent(maxDepthExtent, 0);
+	levelCount = 1;
+	for (uint32_t size = std::max(pyramidExtent.width, pyramidExtent.height); size > 1; size /= 2) {
+		++levelCount;
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = PYRAMID_FORMAT;
+	imageInfo.extent = { pyramidExtent.width, pyramidExtent.height, 1 };
+	imageInfo.mipLevels = levelCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageInfo, allocator, &pyramid) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, pyramid, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, allocator, &pyramidMemory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate depth pyramid memory!");
+	}
+
+	vkBindImageMemory(device, pyramid, pyramidMemory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = pyramid;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = PYRAMID_FORMAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = levelCount;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, allocator, &pyramidView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid view!");
+	}
+
+	// A storage image descriptor always refers to a single level
+	levelViews.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+
+		if (vkCreateImageView(device, &viewInfo, allocator, &levelViews[level]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid view!");
+		}
+	}
+}
+
+void OcclusionCuller::createPipelines(const OcclusionCullerShaders &shaders, VkPipelineCache pipelineCache)
+{
+	auto createLayouts = [this](const std::vector<VkDescriptorType> &types, uint32_t pushConstantSize, VkDescriptorSetLayout &setLayout, VkPipelineLayout &pipelineLayout) {
+		std::vector<VkDescriptorSetLayoutBinding> layoutBindings(types.size());
+		for (uint32_t i = 0; i < layoutBindings.size(); ++i) {
+			layoutBindings[i].binding = i;
+			layoutBindings[i].descriptorType = types[i];
+			layoutBindings[i].descriptorCount = 1;
+			layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+		layoutInfo.pBindings = layoutBindings.data();
+
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &setLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create occlusion culling descriptor set layout!");
+		}
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = pushConstantSize;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &setLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create occlusion culling pipeline layout!");
+		}
+	};
+
+	createLayouts({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE },
+		sizeof(BuildPushConstants), buildSetLayout, buildPipelineLayout);
+
+	// The object buffers are sub-allocated from the frame allocator, a different offset every frame
+	createLayouts({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC }, sizeof(CullPushConstants), cullSetLayout, cullPipelineLayout);
+
+	buildPipeline = createPipeline(shaders.hiZBuild, buildPipelineLayout, pipelineCache);
+	cullPipeline = createPipeline(shaders.occlusionCull, cullPipelineLayout, pipelineCache);
+}
+
+VkPipeline OcclusionCuller::createPipeline(const std::vector<char> &code, VkPipelineLayout layout, VkPipelineCache pipelineCache)
+{
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &moduleInfo, allocator, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = layout;
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &pipeline);
+	vkDestroyShaderModule(device, shaderModule, allocator);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion culling pipeline!");
+	}
+
+	return pipeline;
+}
+
+void OcclusionCuller::initialize(VkCommandBuffer commandBuffer)
+{
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	barrier.srcAccessMask = VK_ACCESS_2_NONE;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = pyramid;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = levelCount;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	// Everything is at the far plane, so nothing is culled until the first real pyramid is built
+	VkClearColorValue farPlane = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+	vkCmdClearColorImage(commandBuffer, pyramid, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &farPlane, 1, &barrier.subresourceRange);
+
+	// The state importPyramid declares the image to be in at the start of every frame
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+RenderGraphResource OcclusionCuller::importPyramid(RenderGraph &graph)
+{
+	RenderGraphImageDesc desc{};
+	desc.format = PYRAMID_FORMAT;
+	desc.extent = pyramidExtent;
+	desc.mipLevels = levelCount;
+
+	// Every frame leaves the pyramid ready to be sampled by the next one, so nothing has to wait at the start of a frame
+	RenderGraphImageState initialState{};
+	initialState.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	initialState.stageMask = VK_PIPELINE_STAGE_2_NONE;
+	initialState.accessMask = VK_ACCESS_2_NONE;
+
+	pyramidResource = graph.importImage("depth pyramid", desc, initialState, RenderGraphAccess::ComputeSampledRead);
+	graph.setImportedImage(pyramidResource, pyramid, pyramidView);
+	return pyramidResource;
+}
+
+void OcclusionCuller::addCullPass(RenderGraph &graph)
+{
+	// Every frame slot has its own region of the frame allocator, the CPU waited for the slot's previous frame before reusing it
+	// The draw command is read back by the host once the frame is done, which is also what keeps the pass from being culled
+	RenderGraphBufferState unusedState{};
+	drawCommandResource = graph.importBuffer("culled draw command", unusedState, RenderGraphAccess::HostRead);
+	visibleObjectsResource = graph.importBuffer("visible objects", unusedState, RenderGraphAccess::VertexAttributeRead);
+
+	graph.addPass("occlusion cull")
+		.read(pyramidResource, RenderGraphAccess::ComputeSampledRead)
+		.write(drawCommandResource, RenderGraphAccess::ComputeStorageWrite)
+		.write(visibleObjectsResource, RenderGraphAccess::ComputeStorageWrite)
+		.setExecute([this](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+			recordCull(commandBuffer);
+		});
+}
+
+void OcclusionCuller::addBuildPass(RenderGraph &graph, RenderGraphResource depth)
+{
+	depthResource = depth;
+
+	graph.addPass("depth pyramid")
+		.read(depth, RenderGraphAccess::ComputeSampledRead)
+		.write(pyramidResource, RenderGraphAccess::ComputeStorageWrite)
+		.setExecute([this](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+			recordBuild(commandBuffer);
+		});
+}
+
+void OcclusionCuller::writeDescriptorSets(const RenderGraph &graph, VkBuffer frameBuffer)
+{
+	uint32_t setCount = levelCount + 1;
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = setCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = levelCount * 2;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	poolSizes[2].descriptorCount = 3;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = setCount;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	if (vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion culling descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(levelCount, buildSetLayout);
+	layouts.push_back(cullSetLayout);
+	std::vector<VkDescriptorSet> descriptorSets(setCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = setCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate occlusion culling descriptor sets!");
+	}
+
+	buildSets.assign(descriptorSets.begin(), descriptorSets.begin() + levelCount);
+	cullSet = descriptorSets.back();
+
+	// Infos are reserved up front, the writes point into these vectors
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	std::vector<VkDescriptorBufferInfo> bufferInfos;
+	std::vector<VkWriteDescriptorSet> writes;
+	imageInfos.reserve(levelCount * 3 + 1);
+	bufferInfos.reserve(3);
+
+	auto addWrite = [&](VkDescriptorSet set, uint32_t binding, VkDescriptorType type) -> VkWriteDescriptorSet & {
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.dstArrayElement = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = type;
+		writes.push_back(write);
+		return writes.back();
+	};
+
+	// The build shader reads either the depth image or the level above, both are bound so every descriptor is valid
+	// The first level binds itself as the unused source
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		imageInfos.push_back({ sampler, graph.getImageView(depthResource), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+		addWrite(buildSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER).pImageInfo = &imageInfos.back();
+
+		imageInfos.push_back({ VK_NULL_HANDLE, levelViews[level == 0 ? 0 : level - 1], VK_IMAGE_LAYOUT_GENERAL });
+		addWrite(buildSets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE).pImageInfo = &imageInfos.back();
+
+		imageInfos.push_back({ VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL });
+		addWrite(buildSets[level], 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE).pImageInfo = &imageInfos.back();
+	}
+
+	imageInfos.push_back({ sampler, pyramidView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+	addWrite(cullSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER).pImageInfo = &imageInfos.back();
+
+	// Ranges are fixed, each frame only supplies the offsets of its allocations
+	VkDeviceSize objectsRange = sizeof(ObjectInstance) * MAX_OBJECTS;
+	bufferInfos.push_back({ frameBuffer, 0, objectsRange });
+	addWrite(cullSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC).pBufferInfo = &bufferInfos.back();
+	bufferInfos.push_back({ frameBuffer, 0, objectsRange });
+	addWrite(cullSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC).pBufferInfo = &bufferInfos.back();
+	bufferInfos.push_back({ frameBuffer, 0, sizeof(VkDrawIndirectCommand) });
+	addWrite(cullSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC).pBufferInfo = &bufferInfos.back();
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void OcclusionCuller::beginFrame(uint32_t frameIndex)
+{
+	currentFrame = frameIndex;
+
+	// The frame that last used this slot has finished, so its draw command holds the final count
+	CulledDraw &previous = frameDraws[frameIndex];
+	if (previous.drawCommand.data != nullptr) {
+		const VkDrawIndirectCommand *command = static_cast<const VkDrawIndirectCommand *>(previous.drawCommand.data);
+		culledCount = previous.objectCount - std::min(command->instanceCount, previous.objectCount);
+
+		culledTotal += culledCount;
+		objectTotal += previous.objectCount;
+		++frameTotal;
+	}
+	previous = {};
+}
+
+ObjectInstance *OcclusionCuller::prepareDraw(FrameAllocator &frameAllocator, RenderGraph &graph, uint32_t objectCount, const glm::vec4 &meshBounds, VkExtent2D renderExtent)
+{
+	if (objectCount > MAX_OBJECTS) {
+		throw std::runtime_error("too many objects to cull!");
+	}
+	this->renderExtent = renderExtent;
+
+	CulledDraw &draw = frameDraws[currentFrame];
+	draw.objectCount = objectCount;
+	draw.meshBounds = meshBounds;
+
+	// Storage allocations so the offsets can be used as dynamic offsets, sized to the ranges of the descriptors
+	draw.objects = frameAllocator.allocateStorage(sizeof(ObjectInstance) * MAX_OBJECTS);
+	draw.visibleObjects = frameAllocator.allocateStorage(sizeof(ObjectInstance) * MAX_OBJECTS);
+	draw.drawCommand = frameAllocator.allocateStorage(sizeof(VkDrawIndirectCommand));
+
+	// The culling pass counts the visible objects into instanceCount, host writes are visible to the GPU once submitted
+	VkDrawIndirectCommand command{};
+	command.vertexCount = 3;
+	command.instanceCount = 0;
+	command.firstVertex = 0;
+	command.firstInstance = 0;
+	std::memcpy(draw.drawCommand.data, &command, sizeof(command));
+
+	graph.setImportedBuffer(drawCommandResource, draw.drawCommand.buffer, draw.drawCommand.offset, draw.drawCommand.size);
+	graph.setImportedBuffer(visibleObjectsResource, draw.visibleObjects.buffer, draw.visibleObjects.offset, draw.visibleObjects.size);
+
+	return static_cast<ObjectInstance *>(draw.objects.data);
+}
+
+void OcclusionCuller::recordCull(VkCommandBuffer commandBuffer)
+{
+	const CulledDraw &draw = frameDraws[currentFrame];
+	VkExtent2D hiZExtent = levelExtent(builtExtent, 0);
+
+	CullPushConstants pushConstants{};
+	pushConstants.meshBounds[0] = draw.meshBounds.x;
+	pushConstants.meshBounds[1] = draw.meshBounds.y;
+	pushConstants.meshBounds[2] = draw.meshBounds.z;
+	pushConstants.meshBounds[3] = draw.meshBounds.w;
+	pushConstants.renderSize[0] = static_cast<int32_t>(builtExtent.width);
+	pushConstants.renderSize[1] = static_cast<int32_t>(builtExtent.height);
+	pushConstants.hiZSize[0] = static_cast<int32_t>(hiZExtent.width);
+	pushConstants.hiZSize[1] = static_cast<int32_t>(hiZExtent.height);
+	pushConstants.objectCount = draw.objectCount;
+	pushConstants.levelCount = levelCount;
+	pushConstants.occlusionEnabled = occlusionEnabled ? 1 : 0;
+
+	std::array<uint32_t, 3> dynamicOffsets = {
+		static_cast<uint32_t>(draw.objects.offset),
+		static_cast<uint32_t>(draw.visibleObjects.offset),
+		static_cast<uint32_t>(draw.drawCommand.offset)
+	};
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullSet,
+		static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+	vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (draw.objectCount + 63) / 64, 1, 1);
+}
+
+void OcclusionCuller::recordBuild(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, buildPipeline);
+
+	// Within the pass every level reads the one written right before it, the graph only orders whole passes
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = pyramid;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &barrier;
+
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		VkExtent2D srcExtent = level == 0 ? renderExtent : levelExtent(renderExtent, level - 1);
+		VkExtent2D dstExtent = levelExtent(renderExtent, level);
+
+		BuildPushConstants pushConstants{};
+		pushConstants.srcSize[0] = static_cast<int32_t>(srcExtent.width);
+		pushConstants.srcSize[1] = static_cast<int32_t>(srcExtent.height);
+		pushConstants.dstSize[0] = static_cast<int32_t>(dstExtent.width);
+		pushConstants.dstSize[1] = static_cast<int32_t>(dstExtent.height);
+		pushConstants.firstLevel = level == 0 ? 1 : 0;
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, buildPipelineLayout, 0, 1, &buildSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, buildPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BuildPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (dstExtent.width + 7) / 8, (dstExtent.height + 7) / 8, 1);
+
+		if (level + 1 < levelCount) {
+			barrier.subresourceRange.baseMipLevel = level;
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		}
+	}
+
+	// Recorded in frame order, so the next frame's culling pass tests against what this frame rendered
+	builtExtent = renderExtent;
+}
+
+void OcclusionCuller::printReport() const
+{
+	if (frameTotal == 0) {
+		return;
+	}
+
+	std::cout << "occlusion culling: " << culledTotal / frameTotal << " of " << objectTotal / frameTotal << " objects culled per frame on average" << std::endl;
+}
+
+VkExtent2D OcclusionCuller::levelExtent(VkExtent2D extent, uint32_t level)
+{
+	uint32_t divisor = 2u << level;
+	return { std::max((extent.width + divisor - 1) / divisor, 1u), std::max((extent.height + divisor - 1) / divisor, 1u) };
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+#include "RenderGraph.hpp"
+#include "FrameAllocator.hpp"
+#include "ObjectInstance.hpp"
+
+// SPIR-V of the compute shaders in shaders/, see compile.bat
+struct OcclusionCullerShaders {
+	std::vector<char> hiZBuild;
+	std::vector<char> occlusionCull;
+};
+
+// What one frame draws, allocated from the frame allocator so that every frame in flight has its own copy
+struct CulledDraw {
+	FrameAllocation objects; // Every object of the scene, MAX_OBJECTS entries
+	FrameAllocation visibleObjects; // Written by the culling pass, bound as the instance vertex buffer
+	FrameAllocation drawCommand; // A single VkDrawIndirectCommand, instanceCount is the number of visible objects
+	uint32_t objectCount = 0;
+	glm::vec4 meshBounds = glm::vec4(0.0f);
+};
+
+/*
+* Hierarchical-Z occlusion culling
+* - A depth pyramid is built by compute from the frame's depth, every level holds the farthest depth of the 2x2 texels below it
+* - The next frame tests every object's bounds against it before anything is drawn, the visible ones are appended to an
+*   instance buffer and counted in an indirect draw command, so the whole scene is still a single draw
+*
+* The pyramid is one frame old, which is only conservative as long as neither the objects nor the view move much in between
+* The pyramid persists across frames, so it's owned here and imported into the graph rather than being a transient image
+*/
+class OcclusionCuller
+{
+public:
+	// Upper bound of objects in a scene, the storage buffer ranges are fixed to it
+	static const uint32_t MAX_OBJECTS = 4096;
+
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, const OcclusionCullerShaders &shaders, VkPipelineCache pipelineCache,
+		VkExtent2D maxDepthExtent, uint32_t frameCount, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+
+	// Clears the pyramid to the far plane and moves it into the layout the graph expects, has to be submitted once before the first frame
+	void initialize(VkCommandBuffer commandBuffer);
+
+	RenderGraphResource importPyramid(RenderGraph &graph);
+	// Adds the pass testing the objects against the pyramid, it has to come before anything draws them
+	// The buffers it writes are imported into the graph, passes drawing with getDraw() declare reads of them
+	void addCullPass(RenderGraph &graph);
+	RenderGraphResource getDrawCommandResource() const { return drawCommandResource; }
+	RenderGraphResource getVisibleObjectsResource() const { return visibleObjectsResource; }
+	// Adds the pass building the pyramid from depth, only the top left renderExtent of depth is used
+	void addBuildPass(RenderGraph &graph, RenderGraphResource depth);
+	// Has to be called after the graph is compiled, that's when its images are created
+	void writeDescriptorSets(const RenderGraph &graph, VkBuffer frameBuffer);
+
+	// Reads back how many objects this frame slot culled last time, has to be called before the slot's frame allocator region is reused
+	void beginFrame(uint32_t frameIndex);
+	// Allocates this frame's draw from the frame allocator, returns where the objectCount objects to cull have to be written
+	// meshBounds is the minimum and maximum position of the mesh every object draws, renderExtent what the frame renders at
+	// The graph's imported draw buffers are pointed at the new allocations
+	ObjectInstance *prepareDraw(FrameAllocator &frameAllocator, RenderGraph &graph, uint32_t objectCount, const glm::vec4 &meshBounds, VkExtent2D renderExtent);
+	// Buffers to draw the visible objects with after the culling pass
+	const CulledDraw &getDraw() const { return frameDraws[currentFrame]; }
+
+	// Without occlusion only objects outside of the view are culled, for comparison
+	void setOcclusionEnabled(bool enabled) { occlusionEnabled = enabled; }
+
+	uint32_t getCulledCount() const { return culledCount; } // Of the most recently read back frame
+	void printReport() const;
+
+private:
+	// Matches the push constant block of hiz_build.comp
+	struct BuildPushConstants {
+		int32_t srcSize[2];
+		int32_t dstSize[2];
+		int32_t firstLevel;
+	};
+
+	// Matches the push constant block of occlusion_cull.comp
+	struct CullPushConstants {
+		float meshBounds[4];
+		int32_t renderSize[2];
+		int32_t hiZSize[2];
+		uint32_t objectCount;
+		uint32_t levelCount;
+		uint32_t occlusionEnabled;
+	};
+
+	static const VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	VkExtent2D pyramidExtent = { 0, 0 }; // Of the first level
+	uint32_t levelCount = 0;
+	VkImage pyramid = VK_NULL_HANDLE;
+	VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+	VkImageView pyramidView = VK_NULL_HANDLE; // Every level, sampled by the culling pass
+	std::vector<VkImageView> levelViews; // One per level, written by the build pass
+	RenderGraphResource pyramidResource = ~0u;
+	RenderGraphResource depthResource = ~0u;
+	RenderGraphResource drawCommandResource = ~0u;
+	RenderGraphResource visibleObjectsResource = ~0u;
+	VkSampler sampler = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout buildSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout buildPipelineLayout = VK_NULL_HANDLE;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline buildPipeline = VK_NULL_HANDLE;
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> buildSets; // One per level
+	VkDescriptorSet cullSet = VK_NULL_HANDLE;
+
+	bool occlusionEnabled = true;
+	VkExtent2D renderExtent = { 0, 0 };
+	VkExtent2D builtExtent = { 0, 0 }; // Render extent the pyramid was last built from, zero before the first build
+
+	// Draw of every frame slot, its draw command is read back once the slot comes around again
+	std::vector<CulledDraw> frameDraws;
+	uint32_t currentFrame = 0;
+	uint32_t culledCount = 0;
+	uint64_t culledTotal = 0;
+	uint64_t objectTotal = 0;
+	uint64_t frameTotal = 0;
+
+	void createPyramid(VkPhysicalDevice physicalDevice, VkExtent2D maxDepthExtent);
+	void createPipelines(const OcclusionCullerShaders &shaders, VkPipelineCache pipelineCache);
+	VkPipeline createPipeline(const std::vector<char> &code, VkPipelineLayout layout, VkPipelineCache pipelineCache);
+	void recordCull(VkCommandBuffer commandBuffer);
+	void recordBuild(VkCommandBuffer commandBuffer);
+
+	static VkExtent2D levelExtent(VkExtent2D extent, uint32_t level);
+};
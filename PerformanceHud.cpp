@@ -0,0 +1,742 @@
+#include "PerformanceHud.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// 5x7 bitmap font, one byte per row with the leftmost pixel in bit 4
+// Only upper case letters, lower case text is drawn with them
+struct Glyph {
+	char character;
+	uint8_t rows[7];
+};
+
+const Glyph GLYPHS[] = {
+	{ ' ', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+	{ '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } },
+	{ '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+	{ '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+	{ ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+	{ '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+	{ ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+	{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+	{ '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+	{ '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+	{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+	{ '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+	{ '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+	{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+	{ '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+	{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+	{ '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+	{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+	{ '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+	{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+	{ '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+	{ '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+	{ '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } },
+	{ 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+	{ 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+	{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+	{ 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+	{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+	{ 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+	{ 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+	{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+	{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+	{ 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+	{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+	{ 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+	{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+	{ 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+	{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+	{ 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+	{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+	{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+	{ 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+	{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+	{ 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+	{ '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } }
+};
+
+const uint32_t GLYPH_COUNT = sizeof(GLYPHS) / sizeof(GLYPHS[0]);
+
+// The frame time graph is scaled so that this many milliseconds fill it
+const float GRAPH_MILLISECONDS = 33.3f;
+const float TARGET_MILLISECONDS = 16.7f;
+
+constexpr uint32_t packColor(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+const uint32_t TEXT_COLOR = packColor(255, 255, 255, 255);
+const uint32_t LABEL_COLOR = packColor(160, 200, 255, 255);
+const uint32_t BACKGROUND_COLOR = packColor(0, 0, 0, 160);
+const uint32_t GOOD_COLOR = packColor(80, 220, 80, 255);
+const uint32_t SLOW_COLOR = packColor(240, 200, 40, 255);
+const uint32_t BAD_COLOR = packColor(240, 60, 40, 255);
+const uint32_t TARGET_LINE_COLOR = packColor(255, 255, 255, 96);
+
+void formatBytes(char *buffer, size_t bufferSize, uint64_t bytes)
+{
+	if (bytes >= 1024 * 1024) {
+		std::snprintf(buffer, bufferSize, "%.1f MB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+	}
+	else {
+		std::snprintf(buffer, bufferSize, "%.1f KB", static_cast<double>(bytes) / 1024.0);
+	}
+}
+
+}
+
+void PerformanceHud::create(VkDevice device, VkPhysicalDevice physicalDevice, const PerformanceHudShaders &shaders, VkPipelineCache pipelineCache, VkFormat colorFormat, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+	vertices.reserve(MAX_VERTICES);
+
+	createAtlas(physicalDevice);
+	createPipeline(shaders, pipelineCache, colorFormat);
+	createDescriptorSet();
+}
+
+void PerformanceHud::destroy()
+{
+	releaseUploadBuffer();
+
+	vkDestroyPipeline(device, pipeline, allocator);
+	vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+	vkDestroyDescriptorPool(device, descriptorPool, allocator);
+	vkDestroyDescriptorSetLayout(device, setLayout, allocator);
+	vkDestroySampler(device, sampler, allocator);
+	vkDestroyImageView(device, atlasView, allocator);
+	vkDestroyImage(device, atlas, allocator);
+	vkFreeMemory(device, atlasMemory, allocator);
+}
+
+void PerformanceHud::createAtlas(VkPhysicalDevice physicalDevice)
+{
+	// One cell per glyph plus a fully covered one for quads
+	uint32_t cellCount = GLYPH_COUNT + 1;
+	atlasExtent.width = ATLAS_COLUMNS * CELL_SIZE;
+	atlasExtent.height = ((cellCount + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS) * CELL_SIZE;
+
+	std::vector<uint8_t> pixels(atlasExtent.width * atlasExtent.height, 0);
+	auto cellOrigin = [this](uint32_t cell) {
+		return (cell / ATLAS_COLUMNS) * CELL_SIZE * atlasExtent.width + (cell % ATLAS_COLUMNS) * CELL_SIZE;
+	};
+
+	for (uint32_t i = 0; i < GLYPH_COUNT; ++i) {
+		uint32_t origin = cellOrigin(i);
+		for (uint32_t y = 0; y < GLYPH_HEIGHT; ++y) {
+			for (uint32_t x = 0; x < GLYPH_WIDTH; ++x) {
+				if (GLYPHS[i].rows[y] & (1u << (GLYPH_WIDTH - 1 - x))) {
+					pixels[origin + y * atlasExtent.width + x] = 255;
+				}
+			}
+		}
+	}
+
+	solidCell = GLYPH_COUNT;
+	uint32_t solidOrigin = cellOrigin(solidCell);
+	for (uint32_t y = 0; y < CELL_SIZE; ++y) {
+		std::memset(&pixels[solidOrigin + y * atlasExtent.width], 255, CELL_SIZE);
+	}
+
+	// Everything not in the font is drawn as '?', lower case as upper case
+	glyphCells.fill(1);
+	for (uint32_t i = 0; i < GLYPH_COUNT; ++i) {
+		glyphCells[static_cast<uint8_t>(GLYPHS[i].character)] = i;
+	}
+	for (char c = 'a'; c <= 'z'; ++c) {
+		glyphCells[static_cast<uint8_t>(c)] = glyphCells[static_cast<uint8_t>(c - 'a' + 'A')];
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8_UNORM;
+	imageInfo.extent = { atlasExtent.width, atlasExtent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageInfo, allocator, &atlas) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create font atlas!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, atlas, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, allocator, &atlasMemory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate font atlas memory!");
+	}
+
+	vkBindImageMemory(device, atlas, atlasMemory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = atlas;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R8_UNORM;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, allocator, &atlasView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create font atlas view!");
+	}
+
+	// Copied into the atlas by initialize()
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = pixels.size();
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, allocator, &uploadBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create font atlas upload buffer!");
+	}
+
+	vkGetBufferMemoryRequirements(device, uploadBuffer, &memoryRequirements);
+
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, allocator, &uploadMemory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate font atlas upload buffer memory!");
+	}
+
+	vkBindBufferMemory(device, uploadBuffer, uploadMemory, 0);
+
+	void *data;
+	vkMapMemory(device, uploadMemory, 0, pixels.size(), 0, &data);
+	std::memcpy(data, pixels.data(), pixels.size());
+	vkUnmapMemory(device, uploadMemory);
+
+	// Glyphs are drawn at an integer scale on whole pixels, nearest keeps them sharp
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	if (vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create font atlas sampler!");
+	}
+}
+
+void PerformanceHud::createPipeline(const PerformanceHudShaders &shaders, VkPipelineCache pipelineCache, VkFormat colorFormat)
+{
+	VkDescriptorSetLayoutBinding layoutBinding{};
+	layoutBinding.binding = 0;
+	layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layoutBinding.descriptorCount = 1;
+	layoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &layoutBinding;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create hud descriptor set layout!");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create hud pipeline layout!");
+	}
+
+	std::array<VkShaderModule, 2> modules{};
+	const std::vector<char> *codes[] = { &shaders.vertex, &shaders.fragment };
+	for (size_t i = 0; i < modules.size(); ++i) {
+		VkShaderModuleCreateInfo moduleInfo{};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = codes[i]->size();
+		moduleInfo.pCode = reinterpret_cast<const uint32_t *>(codes[i]->data());
+
+		if (vkCreateShaderModule(device, &moduleInfo, allocator, &modules[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shader module!");
+		}
+	}
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = modules[0];
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = modules[1];
+	shaderStages[1].pName = "main";
+
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(Vertex);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+	attributeDescriptions[0].offset = offsetof(Vertex, position);
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].location = 1;
+	attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+	attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
+	attributeDescriptions[2].binding = 0;
+	attributeDescriptions[2].location = 2;
+	attributeDescriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+	attributeDescriptions[2].offset = offsetof(Vertex, color);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// Set when recording, the swap chain image is the whole target
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// Blended over the finished frame, no depth
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &colorFormat;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &renderingInfo;
+	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &pipeline);
+	for (VkShaderModule module : modules) {
+		vkDestroyShaderModule(device, module, allocator);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create hud pipeline!");
+	}
+}
+
+void PerformanceHud::createDescriptorSet()
+{
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create hud descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate hud descriptor set!");
+	}
+
+	// The atlas never changes, so the set is written once
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = atlasView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void PerformanceHud::initialize(VkCommandBuffer commandBuffer)
+{
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	barrier.srcAccessMask = VK_ACCESS_2_NONE;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = atlas;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { atlasExtent.width, atlasExtent.height, 1 };
+
+	vkCmdCopyBufferToImage(commandBuffer, uploadBuffer, atlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	// Stays in this layout for the rest of the run
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void PerformanceHud::releaseUploadBuffer()
+{
+	vkDestroyBuffer(device, uploadBuffer, allocator);
+	vkFreeMemory(device, uploadMemory, allocator);
+	uploadBuffer = VK_NULL_HANDLE;
+	uploadMemory = VK_NULL_HANDLE;
+}
+
+void PerformanceHud::addPass(RenderGraph &graph, RenderGraphResource target)
+{
+	targetResource = target;
+
+	this->graph = &graph;
+	pass = &graph.addPass("hud")
+		.write(target, RenderGraphAccess::ColorAttachmentWrite)
+		.setExecute([this](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+			if (vertexCount > 0) {
+				record(commandBuffer, graph.getImageView(targetResource), graph.getDesc(targetResource).extent);
+			}
+		});
+	graph.setPassEnabled(*pass, visible);
+}
+
+void PerformanceHud::setVisible(bool visible)
+{
+	this->visible = visible;
+	if (pass) {
+		graph->setPassEnabled(*pass, visible);
+	}
+}
+
+void PerformanceHud::prepareDraw(FrameAllocator &frameAllocator, const PerformanceHudStats &stats)
+{
+	vertexCount = 0;
+	if (!visible) {
+		return;
+	}
+
+	frameHistory[historyHead] = static_cast<float>(stats.frameMilliseconds);
+	historyHead = (historyHead + 1) % HISTORY_SIZE;
+	historyCount = std::min(historyCount + 1, HISTORY_SIZE);
+
+	vertices.clear();
+
+	// The background is the first quad so everything else is blended over it, its size is only known at the end
+	addSolid(0.0f, 0.0f, 0.0f, 0.0f, BACKGROUND_COLOR);
+
+	const float margin = 8.0f;
+	const float lineHeight = static_cast<float>((GLYPH_HEIGHT + 3) * TEXT_SCALE);
+	const float graphWidth = static_cast<float>(HISTORY_SIZE * 2);
+	const float graphHeight = 48.0f;
+	float x = margin * 2.0f;
+	float y = margin * 2.0f;
+	float right = x + graphWidth;
+	char line[96];
+	char value[32];
+	char limit[32];
+
+	float total = 0.0f;
+	float slowest = 0.0f;
+	for (uint32_t i = 0; i < historyCount; ++i) {
+		total += frameHistory[i];
+		slowest = std::max(slowest, frameHistory[i]);
+	}
+
+	std::snprintf(line, sizeof(line), "FRAME %.2f MS  AVG %.2f  MAX %.2f", stats.frameMilliseconds, total / historyCount, slowest);
+	right = std::max(right, addText(x, y, line, TEXT_COLOR));
+	y += lineHeight;
+
+	addGraph(x, y, graphWidth, graphHeight);
+	y += graphHeight + lineHeight / 2.0f;
+
+	// GPU timings are a few frames old, see GpuTimer
+	if (stats.gpuMilliseconds >= 0.0) {
+		std::snprintf(line, sizeof(line), "GPU %.3f MS", stats.gpuMilliseconds);
+		right = std::max(right, addText(x, y, line, LABEL_COLOR));
+		y += lineHeight;
+	}
+	if (stats.gpuScopes != nullptr) {
+		for (const GpuTimer::ScopeResult &scope : *stats.gpuScopes) {
+			std::snprintf(line, sizeof(line), "  %-16.16s %6.3f MS", scope.name.c_str(), scope.milliseconds);
+			right = std::max(right, addText(x, y, line, TEXT_COLOR));
+			y += lineHeight;
+		}
+	}
+
+	std::snprintf(line, sizeof(line), "RENDER %ux%u", stats.renderExtent.width, stats.renderExtent.height);
+	right = std::max(right, addText(x, y, line, LABEL_COLOR));
+	y += lineHeight * 1.5f;
+
+	right = std::max(right, addText(x, y, "MEMORY", LABEL_COLOR));
+	y += lineHeight;
+
+	formatBytes(value, sizeof(value), stats.hostLiveBytes);
+	formatBytes(limit, sizeof(limit), stats.hostPeakBytes);
+	std::snprintf(line, sizeof(line), "  DRIVER HOST %s  PEAK %s", value, limit);
+	right = std::max(right, addText(x, y, line, TEXT_COLOR));
+	y += lineHeight;
+
+	formatBytes(value, sizeof(value), stats.frameAllocatorPeak);
+	formatBytes(limit, sizeof(limit), stats.frameAllocatorSize);
+	std::snprintf(line, sizeof(line), "  FRAME ALLOCATOR %s / %s", value, limit);
+	right = std::max(right, addText(x, y, line, TEXT_COLOR));
+	y += lineHeight;
+
+	formatBytes(value, sizeof(value), stats.transientBytes);
+	std::snprintf(line, sizeof(line), "  RENDER TARGETS %s", value);
+	right = std::max(right, addText(x, y, line, TEXT_COLOR));
+	y += lineHeight * 1.5f;
+
+	std::snprintf(line, sizeof(line), "OBJECTS %u  DRAWN %u  CULLED %u", stats.objectCount, stats.objectCount - std::min(stats.culledCount, stats.objectCount), stats.culledCount);
+	right = std::max(right, addText(x, y, line, LABEL_COLOR));
+	y += lineHeight;
+
+	// Now that the extent of the content is known
+	float width = right;
+	float height = y - margin;
+	writeQuad(vertices.data(), margin, margin, width, height, solidCell, BACKGROUND_COLOR);
+
+	vertexCount = static_cast<uint32_t>(vertices.size());
+	vertexData = frameAllocator.upload(vertices.data(), sizeof(Vertex) * vertices.size(), alignof(Vertex));
+}
+
+void PerformanceHud::record(VkCommandBuffer commandBuffer, VkImageView targetView, VkExtent2D targetExtent)
+{
+	// Drawn over what the frame already rendered
+	VkRenderingAttachmentInfo colorAttachment{};
+	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachment.imageView = targetView;
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.offset = { 0, 0 };
+	renderingInfo.renderArea.extent = targetExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachment;
+
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(targetExtent.width);
+	viewport.height = static_cast<float>(targetExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = targetExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	PushConstants pushConstants{};
+	pushConstants.pixelToClip[0] = 2.0f / static_cast<float>(targetExtent.width);
+	pushConstants.pixelToClip[1] = 2.0f / static_cast<float>(targetExtent.height);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pushConstants);
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexData.buffer, &vertexData.offset);
+
+	vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+	vkCmdEndRendering(commandBuffer);
+}
+
+void PerformanceHud::addQuad(float x, float y, float width, float height, uint32_t cell, uint32_t color)
+{
+	// Past the limit the rest of the overlay is dropped rather than overflowing the allocation
+	if (vertices.size() + 6 > MAX_VERTICES) {
+		return;
+	}
+
+	vertices.resize(vertices.size() + 6);
+	writeQuad(&vertices[vertices.size() - 6], x, y, width, height, cell, color);
+}
+
+void PerformanceHud::writeQuad(Vertex *output, float x, float y, float width, float height, uint32_t cell, uint32_t color) const
+{
+	float u0 = static_cast<float>((cell % ATLAS_COLUMNS) * CELL_SIZE) / static_cast<float>(atlasExtent.width);
+	float v0 = static_cast<float>((cell / ATLAS_COLUMNS) * CELL_SIZE) / static_cast<float>(atlasExtent.height);
+	float u1 = u0 + static_cast<float>(GLYPH_WIDTH) / static_cast<float>(atlasExtent.width);
+	float v1 = v0 + static_cast<float>(GLYPH_HEIGHT) / static_cast<float>(atlasExtent.height);
+
+	// Quads sample the middle of the covered cell
+	if (cell == solidCell) {
+		u0 = u1 = u0 + static_cast<float>(CELL_SIZE / 2) / static_cast<float>(atlasExtent.width);
+		v0 = v1 = v0 + static_cast<float>(CELL_SIZE / 2) / static_cast<float>(atlasExtent.height);
+	}
+
+	Vertex topLeft = { { x, y }, { u0, v0 }, color };
+	Vertex topRight = { { x + width, y }, { u1, v0 }, color };
+	Vertex bottomLeft = { { x, y + height }, { u0, v1 }, color };
+	Vertex bottomRight = { { x + width, y + height }, { u1, v1 }, color };
+
+	output[0] = topLeft;
+	output[1] = topRight;
+	output[2] = bottomRight;
+	output[3] = topLeft;
+	output[4] = bottomRight;
+	output[5] = bottomLeft;
+}
+
+void PerformanceHud::addSolid(float x, float y, float width, float height, uint32_t color)
+{
+	addQuad(x, y, width, height, solidCell, color);
+}
+
+float PerformanceHud::addText(float x, float y, const char *text, uint32_t color)
+{
+	const float advance = static_cast<float>((GLYPH_WIDTH + 1) * TEXT_SCALE);
+
+	for (const char *c = text; *c != '\0'; ++c) {
+		uint8_t character = static_cast<uint8_t>(*c);
+		if (character != ' ') {
+			uint32_t cell = character < glyphCells.size() ? glyphCells[character] : glyphCells['?'];
+			addQuad(x, y, static_cast<float>(GLYPH_WIDTH * TEXT_SCALE), static_cast<float>(GLYPH_HEIGHT * TEXT_SCALE), cell, color);
+		}
+		x += advance;
+	}
+
+	return x;
+}
+
+void PerformanceHud::addGraph(float x, float y, float width, float height)
+{
+	const float barWidth = width / static_cast<float>(HISTORY_SIZE);
+
+	// Oldest on the left, bars grow up from the bottom
+	for (uint32_t i = 0; i < historyCount; ++i) {
+		float milliseconds = frameHistory[(historyHead + HISTORY_SIZE - historyCount + i) % HISTORY_SIZE];
+		float barHeight = std::max(1.0f, std::min(milliseconds / GRAPH_MILLISECONDS, 1.0f) * height);
+		uint32_t color = milliseconds <= TARGET_MILLISECONDS ? GOOD_COLOR : milliseconds <= GRAPH_MILLISECONDS ? SLOW_COLOR : BAD_COLOR;
+
+		addSolid(x + barWidth * (HISTORY_SIZE - historyCount + i), y + height - barHeight, barWidth, barHeight, color);
+	}
+
+	float targetY = y + height - TARGET_MILLISECONDS / GRAPH_MILLISECONDS * height;
+	addSolid(x, targetY, width, 1.0f, TARGET_LINE_COLOR);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+#include "RenderGraph.hpp"
+#include "FrameAllocator.hpp"
+#include "GpuTimer.hpp"
+
+// SPIR-V of the overlay shaders in shaders/, see compile.bat
+struct PerformanceHudShaders {
+	std::vector<char> vertex;
+	std::vector<char> fragment;
+};
+
+// What the overlay shows for a frame, gathered by the application from the systems that measure it
+struct PerformanceHudStats {
+	double frameMilliseconds = 0.0; // CPU time since the previous frame started
+	double gpuMilliseconds = -1.0; // Busy time summed over the passes, negative if not measured, see GpuTimer::getTotalMilliseconds
+	const std::vector<GpuTimer::ScopeResult> *gpuScopes = nullptr; // Per pass
+	VkExtent2D renderExtent = { 0, 0 };
+	uint64_t hostLiveBytes = 0; // Driver host memory, see HostAllocator
+	uint64_t hostPeakBytes = 0;
+	VkDeviceSize frameAllocatorPeak = 0;
+	VkDeviceSize frameAllocatorSize = 0;
+	VkDeviceSize transientBytes = 0; // Render graph images after aliasing
+	uint32_t objectCount = 0;
+	uint32_t culledCount = 0;
+};
+
+/*
+* Overlay with a frame time graph, GPU pass timings, memory usage and draw counts, drawn on top of the swap chain image
+* - Text and quads are all textured quads into one vertex buffer from the frame allocator, drawn with a single vkCmdDraw
+* - Glyphs come from a small bitmap font baked into an R8 atlas at startup, quads sample a texel that is always covered
+*
+* While hidden the pass is disabled in the render graph, so nothing is built, recorded, transitioned or timed
+*/
+class PerformanceHud
+{
+public:
+	static const uint32_t MAX_VERTICES = 16 * 1024;
+	static const uint32_t HISTORY_SIZE = 120; // Frames shown in the graph
+
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, const PerformanceHudShaders &shaders, VkPipelineCache pipelineCache, VkFormat colorFormat, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+
+	// Uploads the font atlas, has to be submitted once before the first frame, the upload buffer can be released once it finished
+	void initialize(VkCommandBuffer commandBuffer);
+	void releaseUploadBuffer();
+
+	// Adds the pass drawing the overlay onto target, which has to be in colorFormat
+	void addPass(RenderGraph &graph, RenderGraphResource target);
+
+	// Builds this frame's vertices into the frame allocator, does nothing while hidden
+	void prepareDraw(FrameAllocator &frameAllocator, const PerformanceHudStats &stats);
+
+	void setVisible(bool visible);
+	bool isVisible() const { return visible; }
+
+private:
+	// Matches the vertex inputs of hud.vert
+	struct Vertex {
+		float position[2]; // Pixels from the top left
+		float texCoord[2];
+		uint32_t color; // RGBA8, R in the lowest byte
+	};
+
+	// Matches the push constant block of hud.vert
+	struct PushConstants {
+		float pixelToClip[2];
+	};
+
+	static const uint32_t GLYPH_WIDTH = 5;
+	static const uint32_t GLYPH_HEIGHT = 7;
+	static const uint32_t CELL_SIZE = 8; // Glyphs are padded to cells so neighbours never bleed into each other
+	static const uint32_t ATLAS_COLUMNS = 16;
+	static const uint32_t TEXT_SCALE = 2; // Screen pixels per atlas texel
+
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	VkImage atlas = VK_NULL_HANDLE;
+	VkDeviceMemory atlasMemory = VK_NULL_HANDLE;
+	VkImageView atlasView = VK_NULL_HANDLE;
+	VkExtent2D atlasExtent = { 0, 0 };
+	VkBuffer uploadBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory uploadMemory = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	std::array<uint32_t, 128> glyphCells{}; // Atlas cell of every ASCII character, unknown ones map to '?'
+	uint32_t solidCell = 0;
+
+	bool visible = false;
+	RenderGraph *graph = nullptr;
+	RenderGraphPass *pass = nullptr;
+	RenderGraphResource targetResource = ~0u;
+	std::vector<Vertex> vertices; // Kept around so building a frame doesn't allocate
+	FrameAllocation vertexData;
+	uint32_t vertexCount = 0; // Of this frame, 0 while hidden
+
+	std::array<float, HISTORY_SIZE> frameHistory{};
+	uint32_t historyHead = 0;
+	uint32_t historyCount = 0;
+
+	void createAtlas(VkPhysicalDevice physicalDevice);
+	void createPipeline(const PerformanceHudShaders &shaders, VkPipelineCache pipelineCache, VkFormat colorFormat);
+	void createDescriptorSet();
+	void record(VkCommandBuffer commandBuffer, VkImageView targetView, VkExtent2D targetExtent);
+
+	void addQuad(float x, float y, float width, float height, uint32_t cell, uint32_t color);
+	void writeQuad(Vertex *output, float x, float y, float width, float height, uint32_t cell, uint32_t color) const;
+	void addSolid(float x, float y, float width, float height, uint32_t color);
+	// Returns the x the text ended at
+	float addText(float x, float y, const char *text, uint32_t color);
+	void addGraph(float x, float y, float width, float height);
+};
@@ -0,0 +1,122 @@
+#include "PipelineVariantCache.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+void PipelineVariantCache::create(VkDevice device, VkPhysicalDevice physicalDevice, const std::vector<char> &initialData, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+
+	bool compatible = !initialData.empty() && isCacheCompatible(physicalDevice, initialData);
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = compatible ? initialData.size() : 0;
+	createInfo.pInitialData = compatible ? initialData.data() : nullptr;
+
+	if (vkCreatePipelineCache(device, &createInfo, allocator, &pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+void PipelineVariantCache::destroy()
+{
+	for (auto &pipeline : pipelines) {
+		for (auto &variant : pipeline.second.variants) {
+			vkDestroyPipeline(device, variant.second, allocator);
+		}
+	}
+
+	pipelines.clear();
+	vkDestroyPipelineCache(device, pipelineCache, allocator);
+	pipelineCache = VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineVariantCache::get(const std::string &pipelineName, const ShaderVariantKey &key, const BuildFunction &build)
+{
+	PipelineVariants &pipeline = pipelines[pipelineName];
+
+	auto it = pipeline.variants.find(key);
+	if (it != pipeline.variants.end()) {
+		++pipeline.hits;
+		return it->second;
+	}
+
+	++pipeline.misses;
+
+	SpecializationData specialization(key);
+	VkPipeline variant = build(key, key.constants.empty() ? nullptr : &specialization.info, pipelineCache);
+
+	pipeline.variants.emplace(key, variant);
+	return variant;
+}
+
+std::vector<char> PipelineVariantCache::getCacheData() const
+{
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr);
+
+	std::vector<char> data(dataSize);
+	vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data());
+	data.resize(dataSize);
+
+	return data;
+}
+
+size_t PipelineVariantCache::getLiveVariantCount() const
+{
+	size_t count = 0;
+	for (const auto &pipeline : pipelines) {
+		count += pipeline.second.variants.size();
+	}
+
+	return count;
+}
+
+void PipelineVariantCache::printReport() const
+{
+	std::cout << "pipeline variants: " << getLiveVariantCount() << " live" << std::endl;
+
+	for (const auto &pipeline : pipelines) {
+		std::cout << "  " << pipeline.first << ": " << pipeline.second.variants.size() << " variants, "
+			<< pipeline.second.hits << " hits, " << pipeline.second.misses << " builds" << std::endl;
+
+		for (const auto &variant : pipeline.second.variants) {
+			std::cout << "    {";
+			for (size_t i = 0; i < variant.first.constants.size(); ++i) {
+				std::cout << (i > 0 ? ", " : " ") << variant.first.constants[i].first << "=" << variant.first.constants[i].second;
+			}
+			std::cout << " }" << std::endl;
+		}
+	}
+}
+
+/*
+* Pipeline cache data starts with a header describing which device created it
+* - uint32_t headerSize
+* - uint32_t headerVersion
+* - uint32_t vendorID
+* - uint32_t deviceID
+* - uint8_t pipelineCacheUUID[VK_UUID_SIZE]
+* Drivers are required to reject incompatible data, but checking it here avoids relying on every driver getting that right
+*/
+bool PipelineVariantCache::isCacheCompatible(VkPhysicalDevice physicalDevice, const std::vector<char> &data)
+{
+	const size_t headerSize = 16 + VK_UUID_SIZE;
+	if (data.size() < headerSize) {
+		return false;
+	}
+
+	uint32_t header[4];
+	memcpy(header, data.data(), sizeof(header));
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	return header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header[2] == properties.vendorID &&
+		header[3] == properties.deviceID &&
+		memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
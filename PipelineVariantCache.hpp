@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+#include "ShaderVariantKey.hpp"
+
+/*
+* Builds pipelines on demand, one per (pipeline name, variant key)
+* Two levels of caching are involved
+* - Pipelines already built for a key are returned directly from memory
+* - New variants are built through a VkPipelineCache, which can be saved to disk so the driver skips compiling them on the next run
+*/
+class PipelineVariantCache
+{
+public:
+	// Receives the specialization info for the key, which has to be set on the shader stages using the constants
+	using BuildFunction = std::function<VkPipeline(const ShaderVariantKey &key, const VkSpecializationInfo *specializationInfo, VkPipelineCache pipelineCache)>;
+
+	// initialData is the content of a previously saved cache, it's discarded if it was created by another device or driver
+	// allocator is used for the pipeline cache and to destroy the variants, the build functions have to create them with it
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, const std::vector<char> &initialData, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+
+	VkPipeline get(const std::string &pipelineName, const ShaderVariantKey &key, const BuildFunction &build);
+
+	VkPipelineCache getPipelineCache() const { return pipelineCache; }
+	const VkAllocationCallbacks *getAllocator() const { return allocator; }
+	std::vector<char> getCacheData() const;
+	size_t getLiveVariantCount() const;
+	void printReport() const;
+
+private:
+	struct KeyHash {
+		size_t operator()(const ShaderVariantKey &key) const { return key.hash(); }
+	};
+
+	struct PipelineVariants {
+		std::unordered_map<ShaderVariantKey, VkPipeline, KeyHash> variants;
+		uint32_t hits = 0;
+		uint32_t misses = 0;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	std::map<std::string, PipelineVariants> pipelines; // Ordered so the report is stable
+
+	bool isCacheCompatible(VkPhysicalDevice physicalDevice, const std::vector<char> &data);
+};
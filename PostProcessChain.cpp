@@ -0,0 +1,458 @@
+#include "PostProcessChain.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+void PostProcessChain::create(VkDevice device, VkPhysicalDevice physicalDevice, const PostProcessShaders &shaders, VkPipelineCache pipelineCache,
+	const PostProcessSettings &settings, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+	this->settings = settings;
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, COLOR_FORMAT, &formatProperties);
+	VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+	if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures) {
+		throw std::runtime_error("post processing format is not supported!");
+	}
+
+	// Subgroup arithmetic is core since Vulkan 1.1 but still optional per stage and operation
+	VkPhysicalDeviceVulkan11Properties vulkan11Properties{};
+	vulkan11Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &vulkan11Properties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	VkSubgroupFeatureFlags requiredOperations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+	useSubgroups = (vulkan11Properties.subgroupSupportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+		(vulkan11Properties.subgroupSupportedOperations & requiredOperations) == requiredOperations;
+
+	createDescriptorSetLayout();
+	createPipelines(shaders, pipelineCache);
+	createLuminanceBuffer(physicalDevice);
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create post processing sampler!");
+	}
+}
+
+void PostProcessChain::destroy()
+{
+	vkDestroyPipeline(device, histogramPipeline, allocator);
+	vkDestroyPipeline(device, exposurePipeline, allocator);
+	vkDestroyPipeline(device, downsamplePipeline, allocator);
+	vkDestroyPipeline(device, upsamplePipeline, allocator);
+	vkDestroyPipeline(device, tonemapPipeline, allocator);
+
+	vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+	vkDestroyDescriptorPool(device, descriptorPool, allocator);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, allocator);
+	vkDestroySampler(device, sampler, allocator);
+
+	vkUnmapMemory(device, luminanceMemory);
+	vkDestroyBuffer(device, luminanceBuffer, allocator);
+	vkFreeMemory(device, luminanceMemory, allocator);
+
+	bindings.clear();
+}
+
+// Every pass uses the same layout, two sampled inputs, one storage image output and the luminance buffer
+// A shader simply leaves out the bindings it doesn't need
+void PostProcessChain::createDescriptorSetLayout()
+{
+	std::array<VkDescriptorSetLayoutBinding, 4> layoutBindings{};
+	for (uint32_t i = 0; i < layoutBindings.size(); ++i) {
+		layoutBindings[i].binding = i;
+		layoutBindings[i].descriptorCount = 1;
+		layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layoutBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	layoutBindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+	layoutInfo.pBindings = layoutBindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create post processing descriptor set layout!");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create post processing pipeline layout!");
+	}
+}
+
+void PostProcessChain::createPipelines(const PostProcessShaders &shaders, VkPipelineCache pipelineCache)
+{
+	histogramPipeline = createPipeline(shaders.luminanceHistogram, pipelineCache);
+	exposurePipeline = createPipeline(useSubgroups ? shaders.exposureSubgroup : shaders.exposure, pipelineCache);
+	downsamplePipeline = createPipeline(shaders.bloomDownsample, pipelineCache);
+	upsamplePipeline = createPipeline(shaders.bloomUpsample, pipelineCache);
+	tonemapPipeline = createPipeline(shaders.tonemap, pipelineCache);
+}
+
+VkPipeline PostProcessChain::createPipeline(const std::vector<char> &code, VkPipelineCache pipelineCache)
+{
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &moduleInfo, allocator, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &pipeline);
+
+	// Unlike the graphics pipeline's variants nothing else is ever built from these modules
+	vkDestroyShaderModule(device, shaderModule, allocator);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create post processing pipeline!");
+	}
+
+	return pipeline;
+}
+
+// Small enough that host visible memory costs nothing, and the exposure can be read back without a copy
+void PostProcessChain::createLuminanceBuffer(VkPhysicalDevice physicalDevice)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = sizeof(LuminanceData);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, allocator, &luminanceBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create luminance buffer!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, luminanceBuffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, allocator, &luminanceMemory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate luminance buffer memory!");
+	}
+
+	vkBindBufferMemory(device, luminanceBuffer, luminanceMemory, 0);
+
+	void *data;
+	vkMapMemory(device, luminanceMemory, 0, VK_WHOLE_SIZE, 0, &data);
+	luminanceData = static_cast<LuminanceData *>(data);
+
+	// The exposure pass clears the histogram after reading it, so it only has to start out cleared once
+	*luminanceData = {};
+	luminanceData->averageLuminance = settings.keyValue;
+	luminanceData->exposure = 1.0f;
+}
+
+uint32_t PostProcessChain::addBinding(RenderGraphResource inputA, RenderGraphResource inputB, RenderGraphResource output, bool luminanceBuffer)
+{
+	Binding binding;
+	binding.inputA = inputA;
+	binding.inputB = inputB;
+	binding.output = output;
+	binding.luminanceBuffer = luminanceBuffer;
+
+	bindings.push_back(binding);
+	return static_cast<uint32_t>(bindings.size() - 1);
+}
+
+/*
+* Scene -> luminance histogram -> exposure
+* Scene -> bloom down 0 -> ... -> bloom down N-1
+* bloom down N-1 + bloom down N-2 -> bloom up N-2 -> ... -> bloom up 0
+* Scene + bloom up 0 + exposure -> tonemapped output
+*/
+RenderGraphResource PostProcessChain::addPasses(RenderGraph &graph, RenderGraphResource sceneColor, RenderGraphQueue queue)
+{
+	VkExtent2D sceneExtent = graph.getDesc(sceneColor).extent;
+
+	RenderGraphImageDesc desc{};
+	desc.format = COLOR_FORMAT;
+
+	std::array<RenderGraphResource, BLOOM_LEVELS> bloomDown;
+	std::array<RenderGraphResource, BLOOM_LEVELS - 1> bloomUp;
+	for (uint32_t level = 0; level < BLOOM_LEVELS; ++level) {
+		desc.extent = levelExtent(sceneExtent, level);
+		bloomDown[level] = graph.createImage("bloom down " + std::to_string(level), desc);
+		if (level + 1 < BLOOM_LEVELS) {
+			bloomUp[level] = graph.createImage("bloom up " + std::to_string(level), desc);
+		}
+	}
+
+	desc.extent = sceneExtent;
+	RenderGraphResource output = graph.createImage("post output", desc);
+
+	// The previous frame's exposure pass was the last to write the buffer, the host reads the exposure back once the frame is done
+	RenderGraphBufferState luminanceState{};
+	luminanceState.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	luminanceState.accessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	RenderGraphResource luminance = graph.importBuffer("luminance", luminanceState, RenderGraphAccess::HostRead);
+	graph.setImportedBuffer(luminance, luminanceBuffer, 0, VK_WHOLE_SIZE);
+
+	// Both write the imported buffer, which is what keeps them from being culled
+	uint32_t histogramBinding = addBinding(sceneColor, ~0u, ~0u, true);
+	graph.addPass("luminance histogram")
+		.read(sceneColor, RenderGraphAccess::ComputeSampledRead)
+		.write(luminance, RenderGraphAccess::ComputeStorageWrite)
+		.setQueue(queue)
+		.setExecute([this, histogramBinding](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+			PushConstants pushConstants{};
+			pushConstants.srcSize[0] = static_cast<int32_t>(renderExtent.width);
+			pushConstants.srcSize[1] = static_cast<int32_t>(renderExtent.height);
+			pushConstants.params[0] = settings.minLogLuminance;
+			pushConstants.params[1] = 1.0f / (settings.maxLogLuminance - settings.minLogLuminance);
+			dispatch(commandBuffer, histogramPipeline, histogramBinding, pushConstants, renderExtent, 16);
+		});
+
+	uint32_t exposureBinding = addBinding(~0u, ~0u, ~0u, true);
+	graph.addPass("exposure")
+		.write(luminance, RenderGraphAccess::ComputeStorageWrite)
+		.setQueue(queue)
+		.setExecute([this, exposureBinding](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+			PushConstants pushConstants{};
+			pushConstants.srcSize[0] = static_cast<int32_t>(renderExtent.width);
+			pushConstants.srcSize[1] = static_cast<int32_t>(renderExtent.height);
+			pushConstants.params[0] = settings.minLogLuminance;
+			pushConstants.params[1] = settings.maxLogLuminance - settings.minLogLuminance;
+			pushConstants.params[2] = adaptation;
+			pushConstants.params[3] = settings.keyValue;
+
+			// A single workgroup, one invocation per histogram bin
+			dispatch(commandBuffer, exposurePipeline, exposureBinding, pushConstants, { 1, 1 }, 1);
+		});
+
+	for (uint32_t level = 0; level < BLOOM_LEVELS; ++level) {
+		RenderGraphResource source = level == 0 ? sceneColor : bloomDown[level - 1];
+		uint32_t binding = addBinding(source, ~0u, bloomDown[level], false);
+
+		graph.addPass("bloom downsample " + std::to_string(level))
+			.read(source, RenderGraphAccess::ComputeSampledRead)
+			.write(bloomDown[level], RenderGraphAccess::ComputeStorageWrite)
+			.setQueue(queue)
+			.setExecute([this, level, binding](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+				VkExtent2D srcExtent = level == 0 ? renderExtent : levelExtent(renderExtent, level - 1);
+				VkExtent2D dstExtent = levelExtent(renderExtent, level);
+
+				PushConstants pushConstants{};
+				pushConstants.srcSize[0] = static_cast<int32_t>(srcExtent.width);
+				pushConstants.srcSize[1] = static_cast<int32_t>(srcExtent.height);
+				pushConstants.dstSize[0] = static_cast<int32_t>(dstExtent.width);
+				pushConstants.dstSize[1] = static_cast<int32_t>(dstExtent.height);
+				pushConstants.params[0] = settings.bloomThreshold;
+				pushConstants.params[1] = level == 0 ? 1.0f : 0.0f; // Bright pass on the first level only
+				dispatch(commandBuffer, downsamplePipeline, binding, pushConstants, dstExtent, 8);
+			});
+	}
+
+	for (int level = BLOOM_LEVELS - 2; level >= 0; --level) {
+		RenderGraphResource lower = level == BLOOM_LEVELS - 2 ? bloomDown[level + 1] : bloomUp[level + 1];
+		uint32_t binding = addBinding(lower, bloomDown[level], bloomUp[level], false);
+
+		graph.addPass("bloom upsample " + std::to_string(level))
+			.read(lower, RenderGraphAccess::ComputeSampledRead)
+			.read(bloomDown[level], RenderGraphAccess::ComputeSampledRead)
+			.write(bloomUp[level], RenderGraphAccess::ComputeStorageWrite)
+			.setQueue(queue)
+			.setExecute([this, level, binding](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+				VkExtent2D srcExtent = levelExtent(renderExtent, level + 1);
+				VkExtent2D dstExtent = levelExtent(renderExtent, level);
+
+				PushConstants pushConstants{};
+				pushConstants.srcSize[0] = static_cast<int32_t>(srcExtent.width);
+				pushConstants.srcSize[1] = static_cast<int32_t>(srcExtent.height);
+				pushConstants.dstSize[0] = static_cast<int32_t>(dstExtent.width);
+				pushConstants.dstSize[1] = static_cast<int32_t>(dstExtent.height);
+				pushConstants.params[0] = settings.bloomRadius;
+				dispatch(commandBuffer, upsamplePipeline, binding, pushConstants, dstExtent, 8);
+			});
+	}
+
+	uint32_t tonemapBinding = addBinding(sceneColor, bloomUp[0], output, true);
+	graph.addPass("tonemap")
+		.read(sceneColor, RenderGraphAccess::ComputeSampledRead)
+		.read(bloomUp[0], RenderGraphAccess::ComputeSampledRead)
+		.read(luminance, RenderGraphAccess::ComputeStorageRead)
+		.write(output, RenderGraphAccess::ComputeStorageWrite)
+		.setQueue(queue)
+		.setExecute([this, tonemapBinding](VkCommandBuffer commandBuffer, const RenderGraph &graph) {
+			VkExtent2D bloomExtent = levelExtent(renderExtent, 0);
+
+			PushConstants pushConstants{};
+			pushConstants.srcSize[0] = static_cast<int32_t>(bloomExtent.width);
+			pushConstants.srcSize[1] = static_cast<int32_t>(bloomExtent.height);
+			pushConstants.dstSize[0] = static_cast<int32_t>(renderExtent.width);
+			pushConstants.dstSize[1] = static_cast<int32_t>(renderExtent.height);
+			pushConstants.params[0] = settings.bloomIntensity;
+			dispatch(commandBuffer, tonemapPipeline, tonemapBinding, pushConstants, renderExtent, 8);
+		});
+
+	return output;
+}
+
+void PostProcessChain::writeDescriptorSets(const RenderGraph &graph)
+{
+	uint32_t setCount = static_cast<uint32_t>(bindings.size());
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = setCount * 2;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = setCount;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = setCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = setCount;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	if (vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create post processing descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(setCount, descriptorSetLayout);
+	std::vector<VkDescriptorSet> descriptorSets(setCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = setCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate post processing descriptor sets!");
+	}
+
+	// Infos are reserved up front, the writes point into these vectors
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	std::vector<VkWriteDescriptorSet> writes;
+	imageInfos.reserve(setCount * 3);
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = luminanceBuffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	auto addWrite = [&](VkDescriptorSet set, uint32_t binding, VkDescriptorType type) -> VkWriteDescriptorSet & {
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.dstArrayElement = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = type;
+		writes.push_back(write);
+		return writes.back();
+	};
+
+	for (uint32_t i = 0; i < setCount; ++i) {
+		Binding &binding = bindings[i];
+		binding.descriptorSet = descriptorSets[i];
+
+		std::array<RenderGraphResource, 2> inputs = { binding.inputA, binding.inputB };
+		for (uint32_t input = 0; input < inputs.size(); ++input) {
+			if (inputs[input] == ~0u) {
+				continue;
+			}
+
+			imageInfos.push_back({ sampler, graph.getImageView(inputs[input]), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+			addWrite(binding.descriptorSet, input, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER).pImageInfo = &imageInfos.back();
+		}
+
+		if (binding.output != ~0u) {
+			imageInfos.push_back({ VK_NULL_HANDLE, graph.getImageView(binding.output), VK_IMAGE_LAYOUT_GENERAL });
+			addWrite(binding.descriptorSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE).pImageInfo = &imageInfos.back();
+		}
+
+		if (binding.luminanceBuffer) {
+			addWrite(binding.descriptorSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER).pBufferInfo = &bufferInfo;
+		}
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void PostProcessChain::beginFrame(VkExtent2D renderExtent)
+{
+	this->renderExtent = renderExtent;
+
+	// Exponential adaptation that doesn't depend on the frame rate, the first frame jumps straight to the measured value
+	auto now = std::chrono::steady_clock::now();
+	if (firstFrame) {
+		adaptation = 1.0f;
+		firstFrame = false;
+	} else {
+		float deltaTime = std::chrono::duration<float>(now - lastFrameTime).count();
+		adaptation = 1.0f - std::exp(-deltaTime * settings.adaptationSpeed);
+	}
+	lastFrameTime = now;
+
+	float exposure = luminanceData->exposure;
+	adapting = std::abs(exposure - previousExposure) > previousExposure * 0.001f;
+	previousExposure = exposure;
+}
+
+void PostProcessChain::dispatch(VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t binding, const PushConstants &pushConstants,
+	VkExtent2D size, uint32_t localSize) const
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &bindings[binding].descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (size.width + localSize - 1) / localSize, (size.height + localSize - 1) / localSize, 1);
+}
+
+VkExtent2D PostProcessChain::levelExtent(VkExtent2D extent, uint32_t level)
+{
+	uint32_t divisor = 2u << level;
+	return { std::max((extent.width + divisor - 1) / divisor, 1u), std::max((extent.height + divisor - 1) / divisor, 1u) };
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+#include "RenderGraph.hpp"
+
+// SPIR-V of the compute shaders in shaders/, see compile.bat
+struct PostProcessShaders {
+	std::vector<char> luminanceHistogram;
+	std::vector<char> exposure;
+	std::vector<char> exposureSubgroup; // Same shader reducing with subgroup arithmetic, only used if the device supports it
+	std::vector<char> bloomDownsample;
+	std::vector<char> bloomUpsample;
+	std::vector<char> tonemap;
+};
+
+struct PostProcessSettings {
+	float bloomThreshold = 1.0f; // Only what's brighter than this blooms
+	float bloomIntensity = 0.05f;
+	float bloomRadius = 1.0f; // Of the upsample tent filter, in texels
+	float minLogLuminance = -10.0f; // Range the luminance histogram covers, in log2
+	float maxLogLuminance = 4.0f;
+	float adaptationSpeed = 1.5f; // Higher adapts the exposure faster
+	float keyValue = 0.18f; // Middle grey the average luminance is exposed to
+};
+
+/*
+* HDR post processing in compute shaders, added to the render graph as a chain of passes
+* - Luminance histogram, built in shared memory, and an exposure pass reducing it to an average with subgroup arithmetic
+* - Bloom, a bright pass plus downsample chain followed by an upsample chain, every level is its own transient image
+* - Tonemap, combines scene and bloom, applies exposure and the ACES curve
+*
+* The passes can be put on the dedicated compute queue, see RenderGraph for why that doesn't overlap them with graphics work yet
+* Images the graph owns are sampled through descriptor sets written once after the graph is compiled, the histogram
+* and exposure live in a small persistent buffer that carries over from frame to frame, imported into the graph so it orders its accesses
+*/
+class PostProcessChain
+{
+public:
+	// Used for the scene and every image of the chain, storage support for it is required by Vulkan
+	static const VkFormat COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+	static const uint32_t BLOOM_LEVELS = 5;
+
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, const PostProcessShaders &shaders, VkPipelineCache pipelineCache,
+		const PostProcessSettings &settings = {}, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+
+	// Adds the passes processing sceneColor, returns the tonemapped image which has the same extent
+	RenderGraphResource addPasses(RenderGraph &graph, RenderGraphResource sceneColor, RenderGraphQueue queue);
+	// Has to be called after the graph is compiled, that's when its images are created
+	void writeDescriptorSets(const RenderGraph &graph);
+
+	// Called every frame before the graph is executed, renderExtent is the part of the scene that was rendered to
+	void beginFrame(VkExtent2D renderExtent);
+
+	bool isUsingSubgroups() const { return useSubgroups; }
+	// Written by the GPU, so this lags behind by the frames in flight
+	float getExposure() const { return luminanceData->exposure; }
+	// Whether the exposure still moved since the previous frame, the image keeps changing until it settles
+	bool isAdapting() const { return adapting; }
+
+private:
+	// Matches the push constant block declared in every post processing shader
+	struct PushConstants {
+		int32_t srcSize[2];
+		int32_t dstSize[2];
+		float params[4];
+	};
+
+	// Matches the Luminance buffer block
+	struct LuminanceData {
+		uint32_t histogram[256];
+		float averageLuminance;
+		float exposure;
+	};
+
+	// The inputs and output of one dispatch, a descriptor set is written for each
+	struct Binding {
+		RenderGraphResource inputA = ~0u;
+		RenderGraphResource inputB = ~0u;
+		RenderGraphResource output = ~0u;
+		bool luminanceBuffer = false;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	PostProcessSettings settings;
+	bool useSubgroups = false;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
+
+	VkPipeline histogramPipeline = VK_NULL_HANDLE;
+	VkPipeline exposurePipeline = VK_NULL_HANDLE;
+	VkPipeline downsamplePipeline = VK_NULL_HANDLE;
+	VkPipeline upsamplePipeline = VK_NULL_HANDLE;
+	VkPipeline tonemapPipeline = VK_NULL_HANDLE;
+
+	VkBuffer luminanceBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory luminanceMemory = VK_NULL_HANDLE;
+	LuminanceData *luminanceData = nullptr;
+
+	std::vector<Binding> bindings;
+	VkExtent2D renderExtent = { 0, 0 };
+	float adaptation = 0.0f;
+	std::chrono::steady_clock::time_point lastFrameTime;
+	bool firstFrame = true;
+	float previousExposure = 0.0f;
+	bool adapting = true;
+
+	void createDescriptorSetLayout();
+	void createPipelines(const PostProcessShaders &shaders, VkPipelineCache pipelineCache);
+	VkPipeline createPipeline(const std::vector<char> &code, VkPipelineCache pipelineCache);
+	void createLuminanceBuffer(VkPhysicalDevice physicalDevice);
+	uint32_t addBinding(RenderGraphResource inputA, RenderGraphResource inputB, RenderGraphResource output, bool luminanceBuffer);
+
+	void dispatch(VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t binding, const PushConstants &pushConstants,
+		VkExtent2D size, uint32_t localSize) const;
+
+	// Rendered part of a bloom level, each level halves the one before it
+	static VkExtent2D levelExtent(VkExtent2D extent, uint32_t level);
+};
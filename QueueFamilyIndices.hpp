@@ -6,6 +6,7 @@
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> computeFamily; // Compute without graphics, work submitted to it can run alongside graphics work
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
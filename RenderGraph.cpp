@@ -0,0 +1,829 @@
+#include "RenderGraph.hpp"
+#include "VulkanUtils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+	struct AccessInfo {
+		VkPipelineStageFlags2 stageMask;
+		VkAccessFlags2 accessMask;
+		VkImageLayout layout;
+		VkImageUsageFlags usage;
+	};
+
+	// Translates a declared access into what Vulkan needs to know for synchronization
+	AccessInfo getAccessInfo(RenderGraphAccess access)
+	{
+		switch (access) {
+		case RenderGraphAccess::ColorAttachmentWrite:
+			return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+		case RenderGraphAccess::DepthAttachmentWrite:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case RenderGraphAccess::DepthAttachmentRead:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case RenderGraphAccess::FragmentSampledRead:
+			return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case RenderGraphAccess::ComputeSampledRead:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case RenderGraphAccess::ComputeStorageRead:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraphAccess::ComputeStorageWrite:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraphAccess::TransferRead:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+		case RenderGraphAccess::TransferWrite:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+		case RenderGraphAccess::IndirectCommandRead:
+			return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+		case RenderGraphAccess::VertexAttributeRead:
+			return { VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+		case RenderGraphAccess::HostRead:
+			return { VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+		case RenderGraphAccess::Present:
+		default:
+			// Presentation is synchronized through the semaphore passed to vkQueuePresentKHR, only the layout matters
+			return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0 };
+		}
+	}
+
+	// Storage and transfer accesses apply to both, the others only make sense for one kind of resource
+	bool isValidAccess(RenderGraphAccess access, bool isBuffer)
+	{
+		switch (access) {
+		case RenderGraphAccess::ColorAttachmentWrite:
+		case RenderGraphAccess::DepthAttachmentWrite:
+		case RenderGraphAccess::DepthAttachmentRead:
+		case RenderGraphAccess::FragmentSampledRead:
+		case RenderGraphAccess::ComputeSampledRead:
+		case RenderGraphAccess::Present:
+			return !isBuffer;
+		case RenderGraphAccess::IndirectCommandRead:
+		case RenderGraphAccess::VertexAttributeRead:
+		case RenderGraphAccess::HostRead:
+			return isBuffer;
+		default:
+			return true;
+		}
+	}
+
+	// Every access of a resource within a single pass, merged into one
+	struct CombinedAccess {
+		RenderGraphResource resource;
+		RenderGraphImageState state;
+		bool isWrite;
+	};
+
+	std::vector<CombinedAccess> combineAccesses(const std::vector<CombinedAccess> &accesses)
+	{
+		std::vector<CombinedAccess> combined;
+
+		for (const CombinedAccess &access : accesses) {
+			auto it = std::find_if(combined.begin(), combined.end(), [&](const CombinedAccess &other) { return other.resource == access.resource; });
+
+			if (it == combined.end()) {
+				combined.push_back(access);
+				continue;
+			}
+
+			// An image can only be in one layout at a time, a pass can't for example sample and storage write the same image
+			if (it->state.layout != access.state.layout) {
+				throw std::runtime_error("render graph pass uses the same image in two different layouts!");
+			}
+
+			it->state.stageMask |= access.state.stageMask;
+			it->state.accessMask |= access.state.accessMask;
+			it->isWrite = it->isWrite || access.isWrite;
+		}
+
+		return combined;
+	}
+}
+
+RenderGraphPass &RenderGraphPass::read(RenderGraphResource resource, RenderGraphAccess access)
+{
+	accesses.push_back({ resource, access, false });
+	return *this;
+}
+
+RenderGraphPass &RenderGraphPass::write(RenderGraphResource resource, RenderGraphAccess access)
+{
+	accesses.push_back({ resource, access, true });
+	return *this;
+}
+
+RenderGraphPass &RenderGraphPass::setSideEffect(bool sideEffect)
+{
+	this->sideEffect = sideEffect;
+	return *this;
+}
+
+RenderGraphPass &RenderGraphPass::setQueue(RenderGraphQueue queue)
+{
+	this->queue = queue;
+	return *this;
+}
+
+RenderGraphPass &RenderGraphPass::setExecute(ExecuteFunction execute)
+{
+	this->execute = std::move(execute);
+	return *this;
+}
+
+RenderGraphResource RenderGraph::importImage(const std::string &name, const RenderGraphImageDesc &desc, const RenderGraphImageState &initialState, RenderGraphAccess finalAccess)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.imported = true;
+	resource.initialState = initialState;
+	resource.finalAccess = finalAccess;
+
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createImage(const std::string &name, const RenderGraphImageDesc &desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(const std::string &name, const RenderGraphBufferState &initialState, RenderGraphAccess finalAccess)
+{
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.isBuffer = true;
+	resource.initialState = { VK_IMAGE_LAYOUT_UNDEFINED, initialState.stageMask, initialState.accessMask };
+	resource.finalAccess = finalAccess;
+
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphPass &RenderGraph::addPass(const std::string &name)
+{
+	passes.emplace_back();
+	passes.back().name = name;
+	return passes.back();
+}
+
+void RenderGraph::setQueueFamilies(const std::vector<uint32_t> &queueFamilies)
+{
+	this->queueFamilies = queueFamilies;
+	std::sort(this->queueFamilies.begin(), this->queueFamilies.end());
+	this->queueFamilies.erase(std::unique(this->queueFamilies.begin(), this->queueFamilies.end()), this->queueFamilies.end());
+}
+
+void RenderGraph::setTimer(GpuTimer *timer)
+{
+	this->timer = timer;
+}
+
+void RenderGraph::compile(VkDevice device, VkPhysicalDevice physicalDevice, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+	statistics = {};
+	statistics.passCount = static_cast<uint32_t>(passes.size());
+
+	cullPasses();
+	buildSubmissions();
+	computeLifetimes();
+	allocateTransientImages(physicalDevice);
+	planBarriers();
+}
+
+void RenderGraph::destroy()
+{
+	for (Resource &resource : resources) {
+		if (resource.imported) {
+			continue;
+		}
+
+		if (resource.imageView != VK_NULL_HANDLE) {
+			vkDestroyImageView(device, resource.imageView, allocator);
+		}
+		if (resource.image != VK_NULL_HANDLE) {
+			vkDestroyImage(device, resource.image, allocator);
+		}
+	}
+
+	for (MemoryBlock &block : memoryBlocks) {
+		vkFreeMemory(device, block.memory, allocator);
+	}
+
+	resources.clear();
+	passes.clear();
+	submissions.clear();
+	memoryBlocks.clear();
+	finalBarriers.clear();
+}
+
+void RenderGraph::setPassEnabled(RenderGraphPass &pass, bool enabled)
+{
+	if (pass.enabled == enabled) {
+		return;
+	}
+	pass.enabled = enabled;
+
+	// Before compile() there is no plan yet, compile() takes the flag into account
+	if (device != VK_NULL_HANDLE) {
+		replan();
+	}
+}
+
+// Same steps as compile() without touching the images, checked to still fit what they were created for
+void RenderGraph::replan()
+{
+	size_t submissionCount = submissions.size();
+	statistics.culledPassCount = 0;
+	statistics.barrierCount = 0;
+	statistics.barrierBatchCount = 0;
+
+	cullPasses();
+	buildSubmissions();
+	computeLifetimes();
+
+	// The command buffers and semaphores were created for the old submissions
+	if (submissions.size() != submissionCount) {
+		throw std::runtime_error("switching a render graph pass changed its submissions!");
+	}
+
+	// A longer lifetime could overlap the image sharing its memory
+	for (const Resource &resource : resources) {
+		if (resource.imported || resource.firstPass < 0) {
+			continue;
+		}
+
+		bool outsideLifetime = resource.firstPass < resource.allocatedFirstPass || resource.lastPass > resource.allocatedLastPass;
+		if (resource.image == VK_NULL_HANDLE || outsideLifetime || (resource.usage & ~resource.allocatedUsage) != 0) {
+			throw std::runtime_error("switching a render graph pass changed how transient image " + resource.name + " is used!");
+		}
+	}
+
+	planBarriers();
+}
+
+// Walks the passes backwards starting from what leaves the frame (imported resources)
+// Any pass that doesn't contribute to those, directly or through another pass, is culled
+void RenderGraph::cullPasses()
+{
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); ++i) {
+		needed[i] = resources[i].imported;
+	}
+
+	for (auto it = passes.rbegin(); it != passes.rend(); ++it) {
+		RenderGraphPass &pass = *it;
+		if (!pass.enabled) {
+			pass.culled = true;
+			continue;
+		}
+
+		bool alive = pass.sideEffect;
+		for (const auto &access : pass.accesses) {
+			if (access.isWrite && needed[access.resource]) {
+				alive = true;
+			}
+		}
+
+		pass.culled = !alive;
+		if (pass.culled) {
+			++statistics.culledPassCount;
+			continue;
+		}
+
+		// Everything an alive pass reads has to be produced by an earlier pass
+		for (const auto &access : pass.accesses) {
+			if (!access.isWrite) {
+				needed[access.resource] = true;
+			}
+		}
+	}
+}
+
+/*
+* Groups the remaining passes into submissions, a new one starts every time the queue changes
+* The submissions are chained by semaphores, which serializes them, see the comment on the class
+*/
+void RenderGraph::buildSubmissions()
+{
+	submissions.clear();
+
+	for (size_t i = 0; i < passes.size(); ++i) {
+		RenderGraphPass &pass = passes[i];
+		if (pass.culled) {
+			continue;
+		}
+
+		if (submissions.empty() || submissions.back().queue != pass.queue) {
+			submissions.push_back({ pass.queue, {} });
+		}
+
+		submissions.back().passes.push_back(static_cast<uint32_t>(i));
+		pass.submission = static_cast<int>(submissions.size() - 1);
+	}
+
+	// Imported images such as the swap chain are acquired and presented on the graphics queue
+	// Ending on it also means the next frame's graphics work is ordered after this frame's compute work through the semaphores,
+	// the next frame writes the same transient images this frame's compute passes read
+	if (!submissions.empty() && (submissions.front().queue != RenderGraphQueue::Graphics || submissions.back().queue != RenderGraphQueue::Graphics)) {
+		throw std::runtime_error("render graph has to start and end on the graphics queue!");
+	}
+
+	bool usesCompute = std::any_of(submissions.begin(), submissions.end(), [](const Submission &submission) { return submission.queue == RenderGraphQueue::Compute; });
+	if (usesCompute && queueFamilies.empty()) {
+		throw std::runtime_error("render graph uses the compute queue without knowing the queue families!");
+	}
+
+	statistics.submissionCount = static_cast<uint32_t>(submissions.size());
+}
+
+void RenderGraph::computeLifetimes()
+{
+	for (Resource &resource : resources) {
+		resource.firstPass = -1;
+		resource.lastPass = -1;
+		resource.usage = resource.desc.usage;
+	}
+
+	for (size_t i = 0; i < passes.size(); ++i) {
+		if (passes[i].culled) {
+			continue;
+		}
+
+		for (const auto &access : passes[i].accesses) {
+			Resource &resource = resources[access.resource];
+			if (!isValidAccess(access.access, resource.isBuffer)) {
+				throw std::runtime_error("render graph pass " + passes[i].name + " uses " + resource.name + " with an access it doesn't support!");
+			}
+
+			if (resource.firstPass < 0) {
+				resource.firstPass = static_cast<int>(i);
+			}
+			resource.lastPass = static_cast<int>(i);
+			resource.usage |= getAccessInfo(access.access).usage;
+		}
+	}
+
+	for (const Resource &resource : resources) {
+		if (resource.imported && !isValidAccess(resource.finalAccess, resource.isBuffer)) {
+			throw std::runtime_error("render graph resource " + resource.name + " has a final access it doesn't support!");
+		}
+	}
+}
+
+/*
+* Transient images are created up front, then sorted by the pass they are first used in
+* Each image is placed into the first memory block whose previous occupant is no longer used by the time the image is needed
+* This is the same as greedy interval scheduling, images with non-overlapping lifetimes end up sharing memory
+*/
+void RenderGraph::allocateTransientImages(VkPhysicalDevice physicalDevice)
+{
+	std::vector<RenderGraphResource> transients;
+
+	for (size_t i = 0; i < resources.size(); ++i) {
+		Resource &resource = resources[i];
+		if (resource.imported || resource.firstPass < 0) {
+			continue;
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = resource.desc.format;
+		imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+		imageInfo.mipLevels = resource.desc.mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = resource.usage;
+
+		// Concurrent sharing avoids having to release and acquire images every time they move between the graphics and compute queue
+		if (queueFamilies.size() > 1) {
+			imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+			imageInfo.pQueueFamilyIndices = queueFamilies.data();
+		} else {
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		}
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(device, &imageInfo, allocator, &resource.image) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph image!");
+		}
+
+		vkGetImageMemoryRequirements(device, resource.image, &resource.memoryRequirements);
+		resource.allocatedFirstPass = resource.firstPass;
+		resource.allocatedLastPass = resource.lastPass;
+		resource.allocatedUsage = resource.usage;
+		statistics.transientBytesRequested += resource.memoryRequirements.size;
+		transients.push_back(static_cast<RenderGraphResource>(i));
+	}
+
+	std::sort(transients.begin(), transients.end(), [&](RenderGraphResource a, RenderGraphResource b) {
+		return resources[a].firstPass < resources[b].firstPass;
+	});
+
+	for (RenderGraphResource index : transients) {
+		Resource &resource = resources[index];
+
+		// Prefer the smallest free block that already fits, otherwise grow the largest free one
+		int bestBlock = -1;
+		for (size_t i = 0; i < memoryBlocks.size(); ++i) {
+			const MemoryBlock &block = memoryBlocks[i];
+			if (block.lastPass >= resource.firstPass || (block.memoryTypeBits & resource.memoryRequirements.memoryTypeBits) == 0) {
+				continue;
+			}
+
+			if (bestBlock < 0) {
+				bestBlock = static_cast<int>(i);
+				continue;
+			}
+
+			const MemoryBlock &best = memoryBlocks[bestBlock];
+			bool fits = block.size >= resource.memoryRequirements.size;
+			bool bestFits = best.size >= resource.memoryRequirements.size;
+			if ((fits && (!bestFits || block.size < best.size)) || (!fits && !bestFits && block.size > best.size)) {
+				bestBlock = static_cast<int>(i);
+			}
+		}
+
+		if (bestBlock < 0) {
+			memoryBlocks.emplace_back();
+			bestBlock = static_cast<int>(memoryBlocks.size() - 1);
+		}
+
+		MemoryBlock &block = memoryBlocks[bestBlock];
+		block.size = std::max(block.size, resource.memoryRequirements.size);
+		block.memoryTypeBits &= resource.memoryRequirements.memoryTypeBits;
+		block.lastPass = resource.lastPass;
+		block.resources.push_back(index);
+		resource.memoryBlock = bestBlock;
+	}
+
+	for (MemoryBlock &block : memoryBlocks) {
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.size;
+		allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (vkAllocateMemory(device, &allocInfo, allocator, &block.memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate render graph memory!");
+		}
+
+		statistics.transientBytesAllocated += block.size;
+	}
+
+	for (RenderGraphResource index : transients) {
+		Resource &resource = resources[index];
+
+		// Every image in a block starts at offset 0, so the block alignment is whatever the images require
+		vkBindImageMemory(device, resource.image, memoryBlocks[resource.memoryBlock].memory, 0);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = resource.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.desc.format;
+		viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.subresourceRange.aspectMask = resource.desc.aspectMask;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = resource.desc.mipLevels;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(device, &viewInfo, allocator, &resource.imageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph image view!");
+		}
+	}
+
+	statistics.transientImageCount = static_cast<uint32_t>(transients.size());
+}
+
+/*
+* Simulates the frame resource by resource, keeping track of the last write and which stages have already synchronized with it
+* - Layout changes and writes wait on every earlier access
+* - Reads only wait on the last write, and only if their stage hasn't already waited on it
+* - Read after read in the same layout needs no barrier at all
+* When a read needs a barrier, every following read in the same layout is folded into it so they don't need their own
+*
+* Accesses from an earlier submission are already complete, the semaphores in between make their writes visible
+* Only a layout change still needs a barrier, with ALL_COMMANDS as source stage so it's ordered after the semaphore wait
+* Stages of the other queue must not show up in a barrier anyway, a compute queue knows nothing about color attachments
+*
+* Buffers are tracked as if they were images that always stay in the undefined layout, so they never see a layout change
+*/
+void RenderGraph::planBarriers()
+{
+	struct TrackedState {
+		VkImageLayout layout;
+		VkPipelineStageFlags2 writeStages;
+		VkAccessFlags2 writeAccess;
+		VkPipelineStageFlags2 readStages; // Stages that are already ordered after the last write
+		int submission; // Of the last access, -1 before the first one
+	};
+
+	std::vector<std::vector<CombinedAccess>> passAccesses(passes.size());
+	for (size_t i = 0; i < passes.size(); ++i) {
+		if (passes[i].culled) {
+			continue;
+		}
+
+		std::vector<CombinedAccess> accesses;
+		for (const auto &access : passes[i].accesses) {
+			AccessInfo info = getAccessInfo(access.access);
+			VkImageLayout layout = resources[access.resource].isBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : info.layout;
+			accesses.push_back({ access.resource, { layout, info.stageMask, info.accessMask }, access.isWrite });
+		}
+		passAccesses[i] = combineAccesses(accesses);
+	}
+
+	// Stages and writes of every transient image, the next image placed in the same block has to wait on them
+	std::vector<RenderGraphImageState> occupantState(resources.size());
+	std::vector<bool> usedByCompute(resources.size(), false);
+	for (size_t i = 0; i < passes.size(); ++i) {
+		for (const CombinedAccess &access : passAccesses[i]) {
+			occupantState[access.resource].stageMask |= access.state.stageMask;
+			if (access.isWrite) {
+				occupantState[access.resource].accessMask |= access.state.accessMask;
+			}
+			if (passes[i].queue == RenderGraphQueue::Compute) {
+				usedByCompute[access.resource] = true;
+			}
+		}
+	}
+
+	std::vector<TrackedState> states(resources.size());
+	for (size_t i = 0; i < resources.size(); ++i) {
+		const Resource &resource = resources[i];
+
+		if (resource.imported) {
+			states[i] = { resource.initialState.layout, resource.initialState.stageMask, resource.initialState.accessMask, 0, -1 };
+			continue;
+		}
+
+		if (resource.memoryBlock < 0) {
+			states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, -1 };
+			continue;
+		}
+
+		// The contents of a transient image are never preserved, it always starts in an undefined layout
+		// The previous occupant of the memory is the one before it in the block, or the last one from the previous frame
+		const std::vector<RenderGraphResource> &occupants = memoryBlocks[resource.memoryBlock].resources;
+		auto it = std::find(occupants.begin(), occupants.end(), static_cast<RenderGraphResource>(i));
+		RenderGraphResource previous = it == occupants.begin() ? occupants.back() : *(it - 1);
+		states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, occupantState[previous].stageMask, occupantState[previous].accessMask, 0, -1 };
+
+		// If either of them is used on the compute queue the dependency goes through the semaphores, see above
+		if (usedByCompute[previous] || usedByCompute[i]) {
+			states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE, 0, -1 };
+		}
+	}
+
+	for (size_t i = 0; i < passes.size(); ++i) {
+		RenderGraphPass &pass = passes[i];
+		pass.barriers.clear();
+
+		for (const CombinedAccess &access : passAccesses[i]) {
+			TrackedState &state = states[access.resource];
+			bool layoutChange = state.layout != access.state.layout;
+
+			if (state.submission >= 0 && state.submission != pass.submission) {
+				state = { state.layout, layoutChange ? VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, 0, state.submission };
+			}
+
+			if (access.isWrite) {
+				if (layoutChange || state.writeStages != 0 || state.readStages != 0) {
+					RenderGraphImageState src = { state.layout, state.writeStages | state.readStages, state.writeAccess };
+					pass.barriers.push_back({ access.resource, src, access.state });
+				}
+
+				state = { access.state.layout, access.state.stageMask, access.state.accessMask, 0, pass.submission };
+				continue;
+			}
+
+			bool unsynchronizedRead = state.writeStages != 0 && (access.state.stageMask & ~state.readStages) != 0;
+			state.submission = pass.submission;
+			if (!layoutChange && !unsynchronizedRead) {
+				state.readStages |= access.state.stageMask;
+				continue;
+			}
+
+			RenderGraphImageState dst = access.state;
+			for (size_t j = i + 1; j < passes.size(); ++j) {
+				auto next = std::find_if(passAccesses[j].begin(), passAccesses[j].end(), [&](const CombinedAccess &other) { return other.resource == access.resource; });
+				if (next == passAccesses[j].end()) {
+					continue;
+				}
+				if (next->isWrite || next->state.layout != dst.layout || passes[j].submission != pass.submission) {
+					break;
+				}
+				dst.stageMask |= next->state.stageMask;
+				dst.accessMask |= next->state.accessMask;
+			}
+
+			RenderGraphImageState src = { state.layout, layoutChange ? state.writeStages | state.readStages : state.writeStages, state.writeAccess };
+			pass.barriers.push_back({ access.resource, src, dst });
+
+			if (layoutChange) {
+				// The layout transition itself counts as the last write, every reader that follows was folded into this barrier
+				state = { dst.layout, 0, VK_ACCESS_2_NONE, dst.stageMask, pass.submission };
+			} else {
+				state.readStages |= dst.stageMask;
+			}
+		}
+
+		statistics.barrierCount += static_cast<uint32_t>(pass.barriers.size());
+		if (!pass.barriers.empty()) {
+			++statistics.barrierBatchCount;
+		}
+	}
+
+	// Imported resources have to be left in the state the outside world expects, e.g. PRESENT_SRC for swap chain images
+	finalBarriers.clear();
+	for (size_t i = 0; i < resources.size(); ++i) {
+		const Resource &resource = resources[i];
+		if (!resource.imported) {
+			continue;
+		}
+
+		AccessInfo info = getAccessInfo(resource.finalAccess);
+		if (resource.isBuffer) {
+			info.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+		TrackedState &state = states[i];
+
+		// Recorded at the end of the last submission
+		int lastSubmission = static_cast<int>(submissions.size()) - 1;
+		if (state.submission >= 0 && state.submission != lastSubmission) {
+			state = { state.layout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE, 0, lastSubmission };
+		}
+
+		// Same rule as a read within the frame, nothing to do if the final stage already waited on the last write
+		bool unsynchronizedRead = state.writeStages != 0 && (info.stageMask & ~state.readStages) != 0;
+		if (state.layout != info.layout || unsynchronizedRead) {
+			RenderGraphImageState src = { state.layout, state.writeStages | state.readStages, state.writeAccess };
+			RenderGraphImageState dst = { info.layout, info.stageMask, info.accessMask };
+			finalBarriers.push_back({ static_cast<RenderGraphResource>(i), src, dst });
+		}
+	}
+
+	statistics.barrierCount += static_cast<uint32_t>(finalBarriers.size());
+	if (!finalBarriers.empty()) {
+		++statistics.barrierBatchCount;
+	}
+}
+
+void RenderGraph::setImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView)
+{
+	resources[resource].image = image;
+	resources[resource].imageView = imageView;
+}
+
+void RenderGraph::setImportedBuffer(RenderGraphResource resource, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+	resources[resource].buffer = buffer;
+	resources[resource].bufferOffset = offset;
+	resources[resource].bufferSize = size;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) const
+{
+	if (submissions.size() > 1) {
+		throw std::runtime_error("render graph with multiple submissions can't be executed into a single command buffer!");
+	}
+
+	if (!submissions.empty()) {
+		executeSubmission(0, commandBuffer);
+	}
+}
+
+void RenderGraph::executeSubmission(uint32_t submission, VkCommandBuffer commandBuffer) const
+{
+	for (uint32_t index : submissions[submission].passes) {
+		const RenderGraphPass &pass = passes[index];
+
+		recordBarriers(commandBuffer, pass.barriers);
+
+		// The barriers are left out of the measurement, they belong to the transition and not to the pass
+		uint32_t scope = timer ? timer->beginScope(commandBuffer, pass.name) : GpuTimer::INVALID_SCOPE;
+		if (pass.execute) {
+			pass.execute(commandBuffer, *this);
+		}
+		if (timer) {
+			timer->endScope(commandBuffer, scope);
+		}
+	}
+
+	if (submission + 1 == submissions.size()) {
+		recordBarriers(commandBuffer, finalBarriers);
+	}
+}
+
+uint32_t RenderGraph::getFirstSubmission(RenderGraphResource resource) const
+{
+	int firstPass = resources[resource].firstPass;
+	return firstPass < 0 ? 0 : static_cast<uint32_t>(passes[firstPass].submission);
+}
+
+// All barriers of a pass are submitted in a single call so the driver can resolve them together
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<RenderGraphPass::PlannedBarrier> &barriers) const
+{
+	if (barriers.empty()) {
+		return;
+	}
+
+	std::vector<VkImageMemoryBarrier2> imageBarriers;
+	std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+
+	for (const RenderGraphPass::PlannedBarrier &planned : barriers) {
+		const Resource &resource = resources[planned.resource];
+
+		if (resource.isBuffer) {
+			VkBufferMemoryBarrier2 barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+			barrier.srcStageMask = planned.src.stageMask;
+			barrier.srcAccessMask = planned.src.accessMask;
+			barrier.dstStageMask = planned.dst.stageMask;
+			barrier.dstAccessMask = planned.dst.accessMask;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = resource.buffer;
+			barrier.offset = resource.bufferOffset;
+			barrier.size = resource.bufferSize;
+			bufferBarriers.push_back(barrier);
+			continue;
+		}
+
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = planned.src.stageMask;
+		barrier.srcAccessMask = planned.src.accessMask;
+		barrier.dstStageMask = planned.dst.stageMask;
+		barrier.dstAccessMask = planned.dst.accessMask;
+		barrier.oldLayout = planned.src.layout;
+		barrier.newLayout = planned.dst.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.image;
+		barrier.subresourceRange.aspectMask = resource.desc.aspectMask;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		imageBarriers.push_back(barrier);
+	}
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+	dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+	dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+VkImage RenderGraph::getImage(RenderGraphResource resource) const
+{
+	return resources[resource].image;
+}
+
+VkImageView RenderGraph::getImageView(RenderGraphResource resource) const
+{
+	return resources[resource].imageView;
+}
+
+const RenderGraphImageDesc &RenderGraph::getDesc(RenderGraphResource resource) const
+{
+	return resources[resource].desc;
+}
+
+void RenderGraph::printReport() const
+{
+	std::cout << "render graph: " << statistics.passCount << " passes, " << statistics.culledPassCount << " culled" << std::endl;
+	std::cout << "render graph: " << statistics.barrierCount << " barriers in " << statistics.barrierBatchCount << " batches" << std::endl;
+	std::cout << "render graph: " << statistics.submissionCount << " submissions" << std::endl;
+	std::cout << "render graph: " << statistics.transientImageCount << " transient images, "
+		<< statistics.transientBytesAllocated / 1024 << " KiB allocated for " << statistics.transientBytesRequested / 1024 << " KiB requested" << std::endl;
+}
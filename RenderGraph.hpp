@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+#include "GpuTimer.hpp"
+
+/*
+* A Render Graph describes a frame as a list of passes, each pass declaring which resources it reads and writes
+* Given those declarations the graph is able to
+* - Cull passes whose results are never used
+* - Insert the pipeline barriers and layout transitions in between passes, batched into a single vkCmdPipelineBarrier2 per pass
+* - Alias the memory of transient images whose lifetimes do not overlap
+*
+* Resources are images or buffers, buffers are always imported since nothing in a frame needs a transient one
+* They follow the same rules as images, only without layouts, so a buffer barrier is only ever about stages and accesses
+*
+* Usage is split into two phases
+* - Setup, import/create resources, add passes then call compile() once
+* - Execute, called every frame with the command buffer to record into
+*
+* Passes can run on an async compute queue, consecutive passes on the same queue form a submission
+* Submissions have to be submitted in order, each one waiting on the previous one's semaphore at VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+* A semaphore wait also blocks everything submitted to that queue afterwards, so the queues take turns rather than overlap:
+* the graphics queue idles while a compute submission runs, and the next frame's graphics work starts after this frame's compute work
+* Transient images are shared by every frame in flight and aliased with each other, which is what that ordering protects
+*/
+
+using RenderGraphResource = uint32_t;
+
+enum class RenderGraphQueue {
+	Graphics,
+	Compute // A dedicated compute queue, executed in turn with the graphics queue, see above
+};
+
+// How a pass uses a resource, each access maps to a pipeline stage, access mask and image layout
+enum class RenderGraphAccess {
+	ColorAttachmentWrite,
+	DepthAttachmentWrite,
+	DepthAttachmentRead,
+	FragmentSampledRead,
+	ComputeSampledRead,
+	ComputeStorageRead,
+	ComputeStorageWrite,
+	TransferRead,
+	TransferWrite,
+	Present,
+	IndirectCommandRead, // Buffer only
+	VertexAttributeRead, // Buffer only
+	HostRead // Buffer only, for results the CPU reads back once the frame's timeline point is reached
+};
+
+struct RenderGraphImageDesc {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent = { 0, 0 };
+	uint32_t mipLevels = 1;
+	VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	VkImageUsageFlags usage = 0; // Additional usage on top of what's inferred from the declared accesses
+};
+
+// Synchronization state of an image at a point in the frame
+struct RenderGraphImageState {
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+};
+
+// Synchronization state of a buffer at a point in the frame
+struct RenderGraphBufferState {
+	VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+};
+
+class RenderGraph;
+
+class RenderGraphPass
+{
+public:
+	using ExecuteFunction = std::function<void(VkCommandBuffer commandBuffer, const RenderGraph &graph)>;
+
+	RenderGraphPass &read(RenderGraphResource resource, RenderGraphAccess access);
+	RenderGraphPass &write(RenderGraphResource resource, RenderGraphAccess access);
+
+	// Passes with side effects (e.g. writing to a host visible buffer) are never culled
+	RenderGraphPass &setSideEffect(bool sideEffect);
+	RenderGraphPass &setQueue(RenderGraphQueue queue);
+	RenderGraphPass &setExecute(ExecuteFunction execute);
+
+private:
+	friend class RenderGraph;
+
+	struct ResourceAccess {
+		RenderGraphResource resource;
+		RenderGraphAccess access;
+		bool isWrite;
+	};
+
+	std::string name;
+	std::vector<ResourceAccess> accesses;
+	ExecuteFunction execute;
+	RenderGraphQueue queue = RenderGraphQueue::Graphics;
+	bool sideEffect = false;
+	bool enabled = true;
+	bool culled = false;
+	int submission = -1;
+
+	// Barriers that have to be recorded before the pass executes, computed in compile()
+	struct PlannedBarrier {
+		RenderGraphResource resource;
+		RenderGraphImageState src;
+		RenderGraphImageState dst;
+	};
+	std::vector<PlannedBarrier> barriers;
+};
+
+class RenderGraph
+{
+public:
+	struct Statistics {
+		uint32_t passCount = 0;
+		uint32_t culledPassCount = 0;
+		uint32_t barrierCount = 0;
+		uint32_t barrierBatchCount = 0;
+		uint32_t submissionCount = 0;
+		uint32_t transientImageCount = 0;
+		VkDeviceSize transientBytesRequested = 0; // Total memory if every transient image had its own allocation
+		VkDeviceSize transientBytesAllocated = 0; // Actual memory allocated after aliasing
+	};
+
+	/* SETUP */
+	// Imported images are owned outside of the graph, such as the swap chain images
+	// initialState describes the image at the start of the frame, finalAccess the state it has to be left in
+	RenderGraphResource importImage(const std::string &name, const RenderGraphImageDesc &desc, const RenderGraphImageState &initialState, RenderGraphAccess finalAccess);
+	// Transient images are created and owned by the graph, they only live within a frame so their memory can be shared
+	RenderGraphResource createImage(const std::string &name, const RenderGraphImageDesc &desc);
+	// Buffers are always owned outside of the graph, initialState and finalAccess work the same as for images
+	RenderGraphResource importBuffer(const std::string &name, const RenderGraphBufferState &initialState, RenderGraphAccess finalAccess);
+	RenderGraphPass &addPass(const std::string &name);
+
+	// Transient images are shared between these queue families instead of transferring ownership, needed when passes use more than one queue
+	void setQueueFamilies(const std::vector<uint32_t> &queueFamilies);
+	// Every pass that isn't culled is measured as a scope named after the pass
+	void setTimer(GpuTimer *timer);
+
+	// The frame has to start and end on the graphics queue
+	void compile(VkDevice device, VkPhysicalDevice physicalDevice, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+	// Disabled passes are left out like culled ones, switching after compile() only re-plans the barriers between frames
+	// The images stay as they are, so the switch must not change the submissions or need a transient image that wasn't used before
+	void setPassEnabled(RenderGraphPass &pass, bool enabled);
+
+	/* EXECUTE */
+	// Imported images can change every frame, e.g. the acquired swap chain image
+	void setImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView);
+	// The range is what the barriers cover, e.g. a frame's region of a frame allocator buffer
+	void setImportedBuffer(RenderGraphResource resource, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+	// Records the whole frame into one command buffer, only valid if every pass runs on the graphics queue
+	void execute(VkCommandBuffer commandBuffer) const;
+	void executeSubmission(uint32_t submission, VkCommandBuffer commandBuffer) const;
+
+	uint32_t getSubmissionCount() const { return static_cast<uint32_t>(submissions.size()); }
+	RenderGraphQueue getSubmissionQueue(uint32_t submission) const { return submissions[submission].queue; }
+	// The submission that uses the resource first, e.g. the one that has to wait for the swap chain image to be acquired
+	uint32_t getFirstSubmission(RenderGraphResource resource) const;
+
+	VkImage getImage(RenderGraphResource resource) const;
+	VkImageView getImageView(RenderGraphResource resource) const;
+	const RenderGraphImageDesc &getDesc(RenderGraphResource resource) const;
+	const Statistics &getStatistics() const { return statistics; }
+	void printReport() const;
+
+private:
+	struct Resource {
+		std::string name;
+		RenderGraphImageDesc desc;
+		bool imported = false;
+		RenderGraphImageState initialState; // Imported only
+		RenderGraphAccess finalAccess = RenderGraphAccess::Present; // Imported only
+		bool isBuffer = false;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize bufferOffset = 0;
+		VkDeviceSize bufferSize = VK_WHOLE_SIZE;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkImageUsageFlags usage = 0;
+		VkMemoryRequirements memoryRequirements{};
+		int firstPass = -1;
+		int lastPass = -1;
+		int memoryBlock = -1;
+		// Lifetime and usage the transient image was created and placed with, switching passes has to stay within them
+		int allocatedFirstPass = -1;
+		int allocatedLastPass = -1;
+		VkImageUsageFlags allocatedUsage = 0;
+	};
+
+	// A chunk of device memory shared by transient images with non-overlapping lifetimes
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t memoryTypeBits = ~0u;
+		int lastPass = -1;
+		std::vector<RenderGraphResource> resources; // In order of first use
+	};
+
+	// Consecutive passes on the same queue, recorded into one command buffer
+	struct Submission {
+		RenderGraphQueue queue;
+		std::vector<uint32_t> passes;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	GpuTimer *timer = nullptr;
+	std::vector<uint32_t> queueFamilies;
+	std::vector<Submission> submissions;
+	std::vector<Resource> resources;
+	std::deque<RenderGraphPass> passes; // deque so that references returned by addPass stay valid
+	std::vector<MemoryBlock> memoryBlocks;
+	std::vector<RenderGraphPass::PlannedBarrier> finalBarriers;
+	Statistics statistics;
+
+	void cullPasses();
+	void buildSubmissions();
+	void computeLifetimes();
+	void allocateTransientImages(VkPhysicalDevice physicalDevice);
+	void planBarriers();
+	void replan();
+	void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<RenderGraphPass::PlannedBarrier> &barriers) const;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+/*
+* Identifies a variant of a shader through the values of its specialization constants
+* Specialization constants are declared in GLSL as layout(constant_id = x) const uint name = default;
+* Their value is only decided when the pipeline is created, so the driver can constant fold them and remove dead branches
+* Constants that are never set keep the default value declared in the shader
+*/
+struct ShaderVariantKey {
+	std::vector<std::pair<uint32_t, uint32_t>> constants; // constant_id and value, kept sorted by constant_id
+
+	ShaderVariantKey &set(uint32_t constantID, uint32_t value) {
+		auto it = std::lower_bound(constants.begin(), constants.end(), std::make_pair(constantID, 0u),
+			[](const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b) { return a.first < b.first; });
+
+		if (it != constants.end() && it->first == constantID) {
+			it->second = value;
+		} else {
+			constants.insert(it, { constantID, value });
+		}
+
+		return *this;
+	}
+
+	uint32_t get(uint32_t constantID, uint32_t defaultValue) const {
+		for (const auto &constant : constants) {
+			if (constant.first == constantID) {
+				return constant.second;
+			}
+		}
+
+		return defaultValue;
+	}
+
+	bool operator==(const ShaderVariantKey &other) const {
+		return constants == other.constants;
+	}
+
+	size_t hash() const {
+		// FNV-1a over the ids and values
+		uint64_t result = 14695981039346656037ull;
+		for (const auto &constant : constants) {
+			result = (result ^ constant.first) * 1099511628211ull;
+			result = (result ^ constant.second) * 1099511628211ull;
+		}
+
+		return static_cast<size_t>(result);
+	}
+};
+
+// Owns the memory VkSpecializationInfo points to, has to stay alive until the pipeline is created
+struct SpecializationData {
+	std::vector<VkSpecializationMapEntry> entries;
+	std::vector<uint32_t> values;
+	VkSpecializationInfo info{};
+
+	explicit SpecializationData(const ShaderVariantKey &key) {
+		for (const auto &constant : key.constants) {
+			VkSpecializationMapEntry entry{};
+			entry.constantID = constant.first;
+			entry.offset = static_cast<uint32_t>(values.size() * sizeof(uint32_t));
+			entry.size = sizeof(uint32_t);
+
+			entries.push_back(entry);
+			values.push_back(constant.second);
+		}
+
+		info.mapEntryCount = static_cast<uint32_t>(entries.size());
+		info.pMapEntries = entries.data();
+		info.dataSize = values.size() * sizeof(uint32_t);
+		info.pData = values.data();
+	}
+
+	// Copying would leave info pointing into the other object's vectors
+	SpecializationData(const SpecializationData &) = delete;
+	SpecializationData &operator=(const SpecializationData &) = delete;
+};
@@ -0,0 +1,229 @@
+#include "SubmissionScheduler.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+SubmitBatch &SubmitBatch::waitFor(const TimelinePoint &point, VkPipelineStageFlags2 stageMask)
+{
+	if (point.isValid()) {
+		timelineWaits.push_back({ point, stageMask });
+	}
+	return *this;
+}
+
+SubmitBatch &SubmitBatch::waitBinary(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask)
+{
+	VkSemaphoreSubmitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	waitInfo.semaphore = semaphore;
+	waitInfo.stageMask = stageMask;
+	binaryWaits.push_back(waitInfo);
+	return *this;
+}
+
+SubmitBatch &SubmitBatch::signalBinary(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask)
+{
+	VkSemaphoreSubmitInfo signalInfo{};
+	signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	signalInfo.semaphore = semaphore;
+	signalInfo.stageMask = stageMask;
+	binarySignals.push_back(signalInfo);
+	return *this;
+}
+
+void SubmissionScheduler::create(VkDevice device, const VkAllocationCallbacks *allocator)
+{
+	this->device = device;
+	this->allocator = allocator;
+}
+
+void SubmissionScheduler::destroy()
+{
+	for (Queue &queue : queues) {
+		vkDestroySemaphore(device, queue.timeline, allocator);
+	}
+	queues.clear();
+}
+
+uint32_t SubmissionScheduler::addQueue(VkQueue queue, const std::string &name)
+{
+	// Binary is the default, the type is chosen through a struct chained in pNext
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	Queue entry;
+	entry.queue = queue;
+	entry.name = name;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &entry.timeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timeline semaphore!");
+	}
+
+	queues.push_back(std::move(entry));
+	return static_cast<uint32_t>(queues.size() - 1);
+}
+
+TimelinePoint SubmissionScheduler::submit(uint32_t queue, const SubmitBatch &batch)
+{
+	Queue &entry = queues.at(queue);
+	entry.pending.push_back(batch);
+	++batchCount;
+
+	return { queue, ++entry.submittedValue };
+}
+
+void SubmissionScheduler::flush()
+{
+	bool submitted = false;
+	for (Queue &queue : queues) {
+		if (!queue.pending.empty()) {
+			submitPending(queue);
+			submitted = true;
+		}
+	}
+
+	if (submitted) {
+		++flushCount;
+	}
+}
+
+void SubmissionScheduler::submitPending(Queue &queue)
+{
+	size_t count = queue.pending.size();
+	uint64_t firstValue = queue.submittedValue - count + 1;
+
+	// Filled completely before any pointers into them are taken, so they don't move around
+	std::vector<std::vector<VkSemaphoreSubmitInfo>> waitInfos(count);
+	std::vector<std::vector<VkSemaphoreSubmitInfo>> signalInfos(count);
+	std::vector<std::vector<VkCommandBufferSubmitInfo>> commandBufferInfos(count);
+	std::vector<VkSubmitInfo2> submitInfos(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		const SubmitBatch &batch = queue.pending[i];
+
+		for (const auto &[point, stageMask] : batch.timelineWaits) {
+			VkSemaphoreSubmitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+			waitInfo.semaphore = queues.at(point.queue).timeline;
+			waitInfo.value = point.value;
+			waitInfo.stageMask = stageMask;
+			waitInfos[i].push_back(waitInfo);
+		}
+		waitInfos[i].insert(waitInfos[i].end(), batch.binaryWaits.begin(), batch.binaryWaits.end());
+
+		// The timeline is signaled once everything in the batch has finished
+		VkSemaphoreSubmitInfo timelineSignal{};
+		timelineSignal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		timelineSignal.semaphore = queue.timeline;
+		timelineSignal.value = firstValue + i;
+		timelineSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		signalInfos[i].push_back(timelineSignal);
+		signalInfos[i].insert(signalInfos[i].end(), batch.binarySignals.begin(), batch.binarySignals.end());
+
+		for (VkCommandBuffer commandBuffer : batch.commandBuffers) {
+			VkCommandBufferSubmitInfo commandBufferInfo{};
+			commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+			commandBufferInfo.commandBuffer = commandBuffer;
+			commandBufferInfos[i].push_back(commandBufferInfo);
+		}
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		VkSubmitInfo2 &submitInfo = submitInfos[i];
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waitInfos[i].size());
+		submitInfo.pWaitSemaphoreInfos = waitInfos[i].data();
+		submitInfo.commandBufferInfoCount = static_cast<uint32_t>(commandBufferInfos[i].size());
+		submitInfo.pCommandBufferInfos = commandBufferInfos[i].data();
+		submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(signalInfos[i].size());
+		submitInfo.pSignalSemaphoreInfos = signalInfos[i].data();
+	}
+
+	queue.pending.clear();
+
+	if (vkQueueSubmit2(queue.queue, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit to " + queue.name + " queue!");
+	}
+	++submitCallCount;
+}
+
+bool SubmissionScheduler::isReached(const TimelinePoint &point)
+{
+	if (!point.isValid()) {
+		return true;
+	}
+
+	Queue &queue = queues.at(point.queue);
+	if (queue.completedValue >= point.value) {
+		return true;
+	}
+
+	uint64_t value = 0;
+	if (vkGetSemaphoreCounterValue(device, queue.timeline, &value) != VK_SUCCESS) {
+		throw std::runtime_error("failed to read timeline semaphore value!");
+	}
+	queue.completedValue = std::max(queue.completedValue, value);
+
+	return queue.completedValue >= point.value;
+}
+
+bool SubmissionScheduler::wait(const TimelinePoint &point, uint64_t timeout)
+{
+	if (isReached(point)) {
+		return true;
+	}
+
+	// A point whose batch is still pending would never be reached
+	Queue &queue = queues.at(point.queue);
+	if (point.value > queue.submittedValue - queue.pending.size()) {
+		throw std::runtime_error("waiting on a timeline point that hasn't been flushed!");
+	}
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &queue.timeline;
+	waitInfo.pValues = &point.value;
+
+	VkResult result = vkWaitSemaphores(device, &waitInfo, timeout);
+	if (result == VK_TIMEOUT) {
+		return false;
+	}
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to wait on timeline semaphore!");
+	}
+
+	queue.completedValue = std::max(queue.completedValue, point.value);
+	return true;
+}
+
+void SubmissionScheduler::waitIdle()
+{
+	flush();
+
+	for (uint32_t i = 0; i < queues.size(); ++i) {
+		wait({ i, queues[i].submittedValue });
+	}
+}
+
+TimelinePoint SubmissionScheduler::getNextPoint(uint32_t queue) const
+{
+	return { queue, queues.at(queue).submittedValue + 1 };
+}
+
+void SubmissionScheduler::printReport() const
+{
+	if (flushCount == 0) {
+		return;
+	}
+
+	std::cout << "submission scheduler: " << batchCount << " batches in " << submitCallCount << " vkQueueSubmit2 calls over "
+		<< flushCount << " flushes" << std::endl;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+// A value on a queue's timeline, reached once every batch submitted to that queue up to it has finished
+struct TimelinePoint {
+	uint32_t queue = ~0u;
+	uint64_t value = 0;
+
+	bool isValid() const { return queue != ~0u; }
+};
+
+// Command buffers submitted together to one queue, plus what they wait on and signal
+struct SubmitBatch {
+	std::vector<VkCommandBuffer> commandBuffers;
+
+	// Waits on a point of any queue's timeline, including the batch's own queue as batches may overlap otherwise
+	SubmitBatch &waitFor(const TimelinePoint &point, VkPipelineStageFlags2 stageMask);
+	// Binary semaphores are still needed where the swap chain is involved
+	SubmitBatch &waitBinary(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask);
+	SubmitBatch &signalBinary(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask);
+
+private:
+	friend class SubmissionScheduler;
+	std::vector<std::pair<TimelinePoint, VkPipelineStageFlags2>> timelineWaits;
+	std::vector<VkSemaphoreSubmitInfo> binaryWaits;
+	std::vector<VkSemaphoreSubmitInfo> binarySignals;
+};
+
+/*
+* Central place work is submitted to the GPU through, built on timeline semaphores
+* - Every queue owns one timeline semaphore, each batch submitted to it signals the next value
+* - submit() only queues a batch, flush() hands all of a queue's pending batches over in a single vkQueueSubmit2
+* - Waiting on another queue is waiting on a point of its timeline, so no semaphores have to be created per dependency
+* - The CPU waits on or polls points the same way, which replaces per-frame fences
+*
+* Timeline waits may be submitted before the signal they wait on, as long as it is submitted by the same flush()
+* Batches have to be submitted from a single thread
+*/
+class SubmissionScheduler
+{
+public:
+	void create(VkDevice device, const VkAllocationCallbacks *allocator = nullptr);
+	void destroy();
+
+	// Every queue is registered once, the returned id is what batches and points refer to
+	uint32_t addQueue(VkQueue queue, const std::string &name);
+
+	// Returns the point the batch signals once it has finished, known before the batch is actually submitted
+	TimelinePoint submit(uint32_t queue, const SubmitBatch &batch);
+	// Submits everything pending, one vkQueueSubmit2 per queue
+	void flush();
+
+	// Doesn't block, the last value a queue is known to have reached is cached
+	bool isReached(const TimelinePoint &point);
+	// Returns false on timeout, an invalid point counts as reached
+	bool wait(const TimelinePoint &point, uint64_t timeout = UINT64_MAX);
+	// Waits for every batch submitted so far
+	void waitIdle();
+
+	// Point the next batch submitted to the queue will signal
+	TimelinePoint getNextPoint(uint32_t queue) const;
+
+	void printReport() const;
+
+private:
+	struct Queue {
+		VkQueue queue = VK_NULL_HANDLE;
+		std::string name;
+		VkSemaphore timeline = VK_NULL_HANDLE;
+		uint64_t submittedValue = 0; // Handed out by submit()
+		uint64_t completedValue = 0; // Last value read back from the semaphore
+
+		std::vector<SubmitBatch> pending; // Signal the values right up to submittedValue, in order
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks *allocator = nullptr;
+	std::vector<Queue> queues;
+
+	uint64_t batchCount = 0;
+	uint64_t submitCallCount = 0;
+	uint64_t flushCount = 0;
+
+	void submitPending(Queue &queue);
+};
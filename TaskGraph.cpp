@@ -0,0 +1,179 @@
+#include "TaskGraph.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+
+TaskGraph::TaskGraph()
+	: creationTime(Clock::now()), mainThreadId(std::this_thread::get_id())
+{
+}
+
+TaskHandle TaskGraph::addTask(const std::string &name, std::function<void()> function, const std::vector<TaskHandle> &dependencies, Affinity affinity)
+{
+	TaskHandle handle = static_cast<TaskHandle>(tasks.size());
+
+	Task task;
+	task.name = name;
+	task.function = std::move(function);
+	task.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	task.affinity = affinity;
+	tasks.push_back(std::move(task));
+
+	// Dependencies always have a lower handle, so the graph can't contain cycles
+	for (TaskHandle dependency : dependencies) {
+		tasks[dependency].dependents.push_back(handle);
+	}
+
+	return handle;
+}
+
+void TaskGraph::run(ThreadPool &threadPool)
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::queue<TaskHandle> mainThreadQueue;
+	std::vector<std::future<void>> workerJobs;
+	std::vector<uint32_t> remaining(tasks.size());
+	size_t finished = 0;
+	size_t running = 0;
+	std::exception_ptr error;
+
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		remaining[i] = tasks[i].dependencyCount;
+	}
+
+	// schedule is called with the mutex held
+	// execute is called without it, the task runs unlocked and only the bookkeeping afterwards takes the mutex
+	// The only task state written outside of the lock is the task's own timing, which no other thread touches while it runs
+	std::function<void(TaskHandle)> schedule;
+	std::function<void(TaskHandle)> execute;
+
+	execute = [&](TaskHandle handle) {
+		Task &task = tasks[handle];
+		task.onMainThread = std::this_thread::get_id() == mainThreadId;
+		task.start = Clock::now();
+
+		std::exception_ptr taskError;
+		try {
+			task.function();
+		}
+		catch (...) {
+			taskError = std::current_exception();
+		}
+
+		task.end = Clock::now();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		--running;
+		++finished;
+
+		if (taskError && !error) {
+			error = taskError;
+		}
+
+		// After a failure nothing new is started, the tasks already running are allowed to finish
+		if (!error) {
+			for (TaskHandle dependent : task.dependents) {
+				if (--remaining[dependent] == 0) {
+					schedule(dependent);
+				}
+			}
+		}
+
+		condition.notify_all();
+	};
+
+	schedule = [&](TaskHandle handle) {
+		++running;
+
+		if (tasks[handle].affinity == Affinity::MainThread) {
+			mainThreadQueue.push(handle);
+		} else {
+			workerJobs.push_back(threadPool.submit([&execute, handle]() { execute(handle); }));
+		}
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < tasks.size(); ++i) {
+			if (remaining[i] == 0) {
+				schedule(static_cast<TaskHandle>(i));
+			}
+		}
+	}
+
+	// The calling thread takes care of main thread tasks while waiting for the rest
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		condition.wait(lock, [&]() { return !mainThreadQueue.empty() || running == 0; });
+
+		if (mainThreadQueue.empty()) {
+			break;
+		}
+
+		TaskHandle handle = mainThreadQueue.front();
+		mainThreadQueue.pop();
+
+		lock.unlock();
+		execute(handle);
+		lock.lock();
+	}
+
+	lock.unlock();
+
+	// Every task has finished, but a worker may still be returning from execute which lives on this stack
+	for (std::future<void> &job : workerJobs) {
+		job.wait();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	if (finished != tasks.size()) {
+		throw std::runtime_error("task graph finished without running every task!");
+	}
+}
+
+void TaskGraph::markEvent(const std::string &name)
+{
+	events.push_back({ name, Clock::now() });
+}
+
+double TaskGraph::toMilliseconds(Clock::time_point time) const
+{
+	return std::chrono::duration<double, std::milli>(time - creationTime).count();
+}
+
+void TaskGraph::printReport() const
+{
+	std::vector<const Task *> sorted;
+	for (const Task &task : tasks) {
+		sorted.push_back(&task);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const Task *a, const Task *b) { return a->start < b->start; });
+
+	// Formatted on its own stream so the precision doesn't stick to std::cout
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(2);
+	report << "startup timeline (ms):\n";
+
+	for (const Task *task : sorted) {
+		report << "  " << std::setw(8) << toMilliseconds(task->start) << " -> " << std::setw(8) << toMilliseconds(task->end)
+			<< "  " << std::setw(8) << toMilliseconds(task->end) - toMilliseconds(task->start)
+			<< "  " << (task->onMainThread ? "main  " : "worker") << "  " << task->name << "\n";
+	}
+
+	for (const Event &event : events) {
+		report << "  " << std::setw(8) << toMilliseconds(event.time) << "  " << event.name << "\n";
+	}
+
+	std::cout << report.str() << std::flush;
+}
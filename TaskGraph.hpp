@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+using TaskHandle = uint32_t;
+
+/*
+* Runs a set of tasks as soon as the tasks they depend on have finished
+* Independent tasks run in parallel on the thread pool, tasks marked as main thread only run on the thread calling run()
+* This is needed for GLFW, whose window functions may only be called from the main thread
+*
+* Every task records when it started and finished, which printReport() turns into a timeline
+*/
+class TaskGraph
+{
+public:
+	enum class Affinity {
+		AnyThread,
+		MainThread
+	};
+
+	TaskGraph();
+
+	TaskHandle addTask(const std::string &name, std::function<void()> function, const std::vector<TaskHandle> &dependencies = {}, Affinity affinity = Affinity::AnyThread);
+
+	// Blocks until every task has finished, rethrows the first exception a task threw
+	void run(ThreadPool &threadPool);
+
+	// Marks an event outside of the graph on the same timeline, e.g. the first frame being presented
+	void markEvent(const std::string &name);
+	void printReport() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Task {
+		std::string name;
+		std::function<void()> function;
+		std::vector<TaskHandle> dependents;
+		uint32_t dependencyCount = 0;
+		Affinity affinity = Affinity::AnyThread;
+
+		Clock::time_point start;
+		Clock::time_point end;
+		bool onMainThread = false;
+	};
+
+	struct Event {
+		std::string name;
+		Clock::time_point time;
+	};
+
+	std::vector<Task> tasks;
+	std::vector<Event> events;
+	Clock::time_point creationTime;
+	std::thread::id mainThreadId;
+
+	double toMilliseconds(Clock::time_point time) const;
+};
@@ -0,0 +1,51 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0) {
+		// hardware_concurrency may return 0 when it can't be determined
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = std::max(hardwareThreads, 2u) - 1;
+	}
+
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	// Jobs still in the queue are finished before the workers exit
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true) {
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+			if (jobs.empty()) {
+				return;
+			}
+
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+
+		job();
+	}
+}
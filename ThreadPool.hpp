@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/*
+* Fixed set of worker threads pulling jobs from a shared queue
+* Jobs are submitted as any callable, the returned future holds the result or the exception the job threw
+*/
+class ThreadPool
+{
+public:
+	// threadCount of 0 uses one thread per hardware thread, minus one for the main thread
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	template <typename Function>
+	auto submit(Function &&function) -> std::future<decltype(function())> {
+		using Result = decltype(function());
+
+		// std::function has to be copyable, packaged_task isn't, hence the shared_ptr
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+		std::future<Result> future = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push([task]() { (*task)(); });
+		}
+		condition.notify_one();
+
+		return future;
+	}
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+
+	void workerLoop();
+};
@@ -0,0 +1,383 @@
+#include "TransformSystem.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <stdexcept>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TRANSFORM_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SIMD_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TRANSFORM_SIMD_NEON
+#endif
+
+namespace {
+
+// A handful of operations on as many floats as one register holds, all the composition needs
+#if defined(TRANSFORM_SIMD_AVX)
+const uint32_t LANE_COUNT = 8;
+using Lanes = __m256;
+inline Lanes loadLanes(const float *source) { return _mm256_loadu_ps(source); }
+inline void storeLanes(float *destination, Lanes value) { _mm256_storeu_ps(destination, value); }
+inline Lanes addLanes(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes mulLanes(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+#elif defined(TRANSFORM_SIMD_SSE)
+const uint32_t LANE_COUNT = 4;
+using Lanes = __m128;
+inline Lanes loadLanes(const float *source) { return _mm_loadu_ps(source); }
+inline void storeLanes(float *destination, Lanes value) { _mm_storeu_ps(destination, value); }
+inline Lanes addLanes(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes mulLanes(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+#elif defined(TRANSFORM_SIMD_NEON)
+const uint32_t LANE_COUNT = 4;
+using Lanes = float32x4_t;
+inline Lanes loadLanes(const float *source) { return vld1q_f32(source); }
+inline void storeLanes(float *destination, Lanes value) { vst1q_f32(destination, value); }
+inline Lanes addLanes(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+inline Lanes mulLanes(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+#else
+const uint32_t LANE_COUNT = 1;
+using Lanes = float;
+inline Lanes loadLanes(const float *source) { return *source; }
+inline void storeLanes(float *destination, Lanes value) { *destination = value; }
+inline Lanes addLanes(Lanes a, Lanes b) { return a + b; }
+inline Lanes mulLanes(Lanes a, Lanes b) { return a * b; }
+#endif
+
+// Four transforms from the separate arrays to four consecutive ObjectInstances
+inline void interleaveFour(ObjectInstance *output, const float *x, const float *y, const float *depth, const float *scale)
+{
+#if defined(TRANSFORM_SIMD_AVX) || defined(TRANSFORM_SIMD_SSE)
+	__m128 row0 = _mm_loadu_ps(x);
+	__m128 row1 = _mm_loadu_ps(y);
+	__m128 row2 = _mm_loadu_ps(depth);
+	__m128 row3 = _mm_loadu_ps(scale);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+	float *destination = reinterpret_cast<float *>(output);
+	_mm_storeu_ps(destination, row0);
+	_mm_storeu_ps(destination + 4, row1);
+	_mm_storeu_ps(destination + 8, row2);
+	_mm_storeu_ps(destination + 12, row3);
+#elif defined(TRANSFORM_SIMD_NEON)
+	float32x4x4_t rows = { { vld1q_f32(x), vld1q_f32(y), vld1q_f32(depth), vld1q_f32(scale) } };
+	vst4q_f32(reinterpret_cast<float *>(output), rows);
+#else
+	for (uint32_t i = 0; i < 4; ++i) {
+		output[i].positionScale = glm::vec4(x[i], y[i], depth[i], scale[i]);
+	}
+#endif
+}
+
+// Splits [begin, end) into chunks, all but the first run on the pool, the calling thread takes the first one and waits for the rest
+void forEachChunk(ThreadPool *threadPool, uint32_t begin, uint32_t end, const std::function<void(uint32_t, uint32_t)> &function)
+{
+	if (threadPool == nullptr || end - begin <= TransformSystem::CHUNK_SIZE) {
+		function(begin, end);
+		return;
+	}
+
+	// Reserved up front so a submitted job's future can't be lost to a failing push_back
+	std::vector<std::future<void>> chunks;
+	chunks.reserve((end - begin - 1) / TransformSystem::CHUNK_SIZE);
+
+	std::exception_ptr error;
+	try {
+		for (uint32_t chunkBegin = begin + TransformSystem::CHUNK_SIZE; chunkBegin < end; chunkBegin += TransformSystem::CHUNK_SIZE) {
+			uint32_t chunkEnd = std::min(chunkBegin + TransformSystem::CHUNK_SIZE, end);
+			chunks.push_back(threadPool->submit([&function, chunkBegin, chunkEnd]() { function(chunkBegin, chunkEnd); }));
+		}
+
+		function(begin, begin + TransformSystem::CHUNK_SIZE);
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+
+	// The jobs reference function, every one of them has to finish before returning, get() rethrows what a job threw
+	for (std::future<void> &chunk : chunks) {
+		try {
+			chunk.get();
+		}
+		catch (...) {
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+}
+
+TransformSystem::TransformSystem()
+{
+	// The identity parent of every root, never dirty and never written out
+	localX.push_back(0.0f);
+	localY.push_back(0.0f);
+	localDepth.push_back(0.0f);
+	localScale.push_back(1.0f);
+	worldX.push_back(0.0f);
+	worldY.push_back(0.0f);
+	worldDepth.push_back(0.0f);
+	worldScale.push_back(1.0f);
+	parents.push_back(0);
+	levels.push_back(0);
+	dirty.push_back(0);
+	handleOfSlot.push_back(INVALID_TRANSFORM);
+}
+
+void TransformSystem::reserve(uint32_t count)
+{
+	for (std::vector<float> *values : { &localX, &localY, &localDepth, &localScale, &worldX, &worldY, &worldDepth, &worldScale }) {
+		values->reserve(count + 1);
+	}
+	parents.reserve(count + 1);
+	levels.reserve(count + 1);
+	dirty.reserve(count + 1);
+	handleOfSlot.reserve(count + 1);
+	slotOfHandle.reserve(count);
+}
+
+TransformHandle TransformSystem::create(const Transform &local, TransformHandle parent)
+{
+	uint32_t parentSlot = 0;
+	uint32_t level = 0;
+	if (parent != INVALID_TRANSFORM) {
+		if (parent >= slotOfHandle.size()) {
+			throw std::runtime_error("failed to find parent transform!");
+		}
+		parentSlot = slotOfHandle[parent];
+		level = levels[parentSlot] + 1;
+	}
+
+	TransformHandle handle = static_cast<TransformHandle>(slotOfHandle.size());
+	uint32_t slot = static_cast<uint32_t>(parents.size());
+
+	localX.push_back(local.position.x);
+	localY.push_back(local.position.y);
+	localDepth.push_back(local.depth);
+	localScale.push_back(local.scale);
+	worldX.push_back(0.0f);
+	worldY.push_back(0.0f);
+	worldDepth.push_back(0.0f);
+	worldScale.push_back(1.0f);
+	parents.push_back(parentSlot);
+	levels.push_back(level);
+	dirty.push_back(1);
+	handleOfSlot.push_back(handle);
+	slotOfHandle.push_back(slot);
+	anyDirty = true;
+
+	// Appending keeps the order as long as the level is the last one or starts a new one
+	if (level == levelStarts.size()) {
+		levelStarts.push_back(slot);
+	}
+	else if (level + 1 < levelStarts.size()) {
+		orderDirty = true;
+	}
+
+	return handle;
+}
+
+void TransformSystem::setLocal(TransformHandle transform, const Transform &local)
+{
+	uint32_t slot = slotOfHandle[transform];
+	localX[slot] = local.position.x;
+	localY[slot] = local.position.y;
+	localDepth[slot] = local.depth;
+	localScale[slot] = local.scale;
+	dirty[slot] = 1;
+	anyDirty = true;
+}
+
+Transform TransformSystem::getLocal(TransformHandle transform) const
+{
+	uint32_t slot = slotOfHandle[transform];
+
+	Transform local;
+	local.position = glm::vec2(localX[slot], localY[slot]);
+	local.depth = localDepth[slot];
+	local.scale = localScale[slot];
+	return local;
+}
+
+Transform TransformSystem::getWorld(TransformHandle transform) const
+{
+	uint32_t slot = slotOfHandle[transform];
+
+	Transform world;
+	world.position = glm::vec2(worldX[slot], worldY[slot]);
+	world.depth = worldDepth[slot];
+	world.scale = worldScale[slot];
+	return world;
+}
+
+void TransformSystem::update(ObjectInstance *output, ThreadPool *threadPool)
+{
+	if (orderDirty) {
+		sortByLevel();
+	}
+
+	uint32_t slotCount = static_cast<uint32_t>(parents.size());
+	updatedCount = 0;
+
+	if (anyDirty) {
+		// Levels one after the other, the transforms within a level only depend on the ones before
+		for (size_t level = 0; level < levelStarts.size(); ++level) {
+			uint32_t begin = levelStarts[level];
+			uint32_t end = level + 1 < levelStarts.size() ? levelStarts[level + 1] : slotCount;
+
+			forEachChunk(threadPool, begin, end, [this](uint32_t chunkBegin, uint32_t chunkEnd) {
+				updateRange(chunkBegin, chunkEnd);
+			});
+		}
+
+		std::fill(dirty.begin(), dirty.end(), static_cast<uint8_t>(0));
+		anyDirty = false;
+	}
+
+	if (output != nullptr) {
+		forEachChunk(threadPool, 1, slotCount, [this, output](uint32_t chunkBegin, uint32_t chunkEnd) {
+			writeRange(output, chunkBegin, chunkEnd);
+		});
+	}
+}
+
+void TransformSystem::updateRange(uint32_t begin, uint32_t end)
+{
+	// Parents are on a previous level, their dirty flag already includes everything above them
+	uint32_t dirtyCount = 0;
+	for (uint32_t slot = begin; slot < end; ++slot) {
+		dirty[slot] |= dirty[parents[slot]];
+		dirtyCount += dirty[slot];
+	}
+	if (dirtyCount == 0) {
+		return;
+	}
+	updatedCount.fetch_add(dirtyCount, std::memory_order_relaxed);
+
+	// world = parent world * local, for a translation, depth offset and uniform scale that is
+	// position = parent position + parent scale * local position, depth = parent depth + local depth, scale = parent scale * local scale
+	uint32_t slot = begin;
+	for (; slot + LANE_COUNT <= end; slot += LANE_COUNT) {
+		// Groups without a dirty transform are skipped, the clean ones within a dirty group are recomputed from unchanged inputs
+		bool groupDirty = false;
+		for (uint32_t lane = 0; lane < LANE_COUNT; ++lane) {
+			groupDirty |= dirty[slot + lane] != 0;
+		}
+		if (!groupDirty) {
+			continue;
+		}
+
+		// Parents are anywhere in the previous levels, they're gathered into contiguous lanes first
+		alignas(32) float parentX[LANE_COUNT];
+		alignas(32) float parentY[LANE_COUNT];
+		alignas(32) float parentDepth[LANE_COUNT];
+		alignas(32) float parentScale[LANE_COUNT];
+		for (uint32_t lane = 0; lane < LANE_COUNT; ++lane) {
+			uint32_t parent = parents[slot + lane];
+			parentX[lane] = worldX[parent];
+			parentY[lane] = worldY[parent];
+			parentDepth[lane] = worldDepth[parent];
+			parentScale[lane] = worldScale[parent];
+		}
+
+		Lanes scale = loadLanes(parentScale);
+		storeLanes(&worldX[slot], addLanes(loadLanes(parentX), mulLanes(scale, loadLanes(&localX[slot]))));
+		storeLanes(&worldY[slot], addLanes(loadLanes(parentY), mulLanes(scale, loadLanes(&localY[slot]))));
+		storeLanes(&worldDepth[slot], addLanes(loadLanes(parentDepth), loadLanes(&localDepth[slot])));
+		storeLanes(&worldScale[slot], mulLanes(scale, loadLanes(&localScale[slot])));
+	}
+
+	for (; slot < end; ++slot) {
+		if (dirty[slot] == 0) {
+			continue;
+		}
+
+		uint32_t parent = parents[slot];
+		worldX[slot] = worldX[parent] + worldScale[parent] * localX[slot];
+		worldY[slot] = worldY[parent] + worldScale[parent] * localY[slot];
+		worldDepth[slot] = worldDepth[parent] + localDepth[slot];
+		worldScale[slot] = worldScale[parent] * localScale[slot];
+	}
+}
+
+void TransformSystem::writeRange(ObjectInstance *output, uint32_t begin, uint32_t end) const
+{
+	// Slot 0 is the identity, instances start at slot 1
+	uint32_t slot = begin;
+	for (; slot + 4 <= end; slot += 4) {
+		interleaveFour(output + slot - 1, &worldX[slot], &worldY[slot], &worldDepth[slot], &worldScale[slot]);
+	}
+
+	for (; slot < end; ++slot) {
+		output[slot - 1].positionScale = glm::vec4(worldX[slot], worldY[slot], worldDepth[slot], worldScale[slot]);
+	}
+}
+
+void TransformSystem::sortByLevel()
+{
+	uint32_t slotCount = static_cast<uint32_t>(parents.size());
+	uint32_t levelCount = *std::max_element(levels.begin() + 1, levels.end()) + 1;
+
+	// Counting sort by level, stable so the order within a level stays the same
+	std::vector<uint32_t> levelSizes(levelCount, 0);
+	for (uint32_t slot = 1; slot < slotCount; ++slot) {
+		++levelSizes[levels[slot]];
+	}
+
+	levelStarts.assign(levelCount, 0);
+	uint32_t nextStart = 1;
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		levelStarts[level] = nextStart;
+		nextStart += levelSizes[level];
+	}
+
+	std::vector<uint32_t> newSlots(slotCount, 0);
+	std::vector<uint32_t> levelCursors = levelStarts;
+	for (uint32_t slot = 1; slot < slotCount; ++slot) {
+		newSlots[slot] = levelCursors[levels[slot]]++;
+	}
+
+	auto permute = [&newSlots, slotCount](auto &values) {
+		auto sorted = values;
+		for (uint32_t slot = 1; slot < slotCount; ++slot) {
+			sorted[newSlots[slot]] = values[slot];
+		}
+		values.swap(sorted);
+	};
+
+	permute(localX);
+	permute(localY);
+	permute(localDepth);
+	permute(localScale);
+	permute(worldX);
+	permute(worldY);
+	permute(worldDepth);
+	permute(worldScale);
+	permute(levels);
+	permute(dirty);
+	permute(handleOfSlot);
+	permute(parents);
+
+	// Parents still point to their old slots, slot 0 maps to itself
+	for (uint32_t slot = 1; slot < slotCount; ++slot) {
+		parents[slot] = newSlots[parents[slot]];
+	}
+	for (uint32_t slot = 1; slot < slotCount; ++slot) {
+		slotOfHandle[handleOfSlot[slot]] = slot;
+	}
+
+	orderDirty = false;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "ObjectInstance.hpp"
+#include "ThreadPool.hpp"
+
+using TransformHandle = uint32_t;
+
+// Placement relative to the parent, or to normalized device coordinates for a root
+// Same terms as ObjectInstance::positionScale, which is all the vertex shader consumes
+struct Transform {
+	glm::vec2 position = glm::vec2(0.0f);
+	float depth = 0.0f;
+	float scale = 1.0f;
+};
+
+/*
+* Hierarchy of transforms stored as a structure of arrays, every transform is one instance of the scene
+* - Transforms are kept sorted by their depth in the hierarchy, so a parent is always final before its children are updated
+*   and every level can be split into independent chunks for the worker threads
+* - Only transforms whose local transform changed, and everything below them, get their world transform recomputed
+* - World transforms are composed several at a time with SSE, AVX or NEON, whichever the compiler targets
+*   (/arch:AVX2 on MSVC, -mavx2 on GCC and Clang for the 8 wide version)
+*   The shipped projects don't set EnableEnhancedInstructionSet, so they build and benchmark the 4 wide SSE version
+* - update() writes every world transform straight into the instance buffer in ObjectInstance layout
+*
+* Handles stay valid for the lifetime of the system, the order instances are written in changes when a transform
+* is created below a level that already has transforms after it
+*/
+class TransformSystem
+{
+public:
+	static constexpr TransformHandle INVALID_TRANSFORM = UINT32_MAX;
+	// Transforms of one level a single job works on, small hierarchies are updated on the calling thread
+	static constexpr uint32_t CHUNK_SIZE = 16 * 1024;
+
+	TransformSystem();
+
+	void reserve(uint32_t count);
+	// The parent has to exist already
+	TransformHandle create(const Transform &local, TransformHandle parent = INVALID_TRANSFORM);
+	void setLocal(TransformHandle transform, const Transform &local);
+	Transform getLocal(TransformHandle transform) const;
+	// As of the last update()
+	Transform getWorld(TransformHandle transform) const;
+	uint32_t getCount() const { return static_cast<uint32_t>(slotOfHandle.size()); }
+
+	// Recomputes the world transforms of every dirty subtree, then writes all of them to output unless it's nullptr
+	// output has to have room for getCount() instances, without a thread pool everything runs on the calling thread
+	void update(ObjectInstance *output, ThreadPool *threadPool = nullptr);
+
+	// How many world transforms the last update() recomputed
+	uint32_t getUpdatedCount() const { return updatedCount; }
+
+private:
+	// Indexed by slot, the storage order, slot 0 is an identity transform every root uses as its parent
+	std::vector<float> localX;
+	std::vector<float> localY;
+	std::vector<float> localDepth;
+	std::vector<float> localScale;
+	std::vector<float> worldX;
+	std::vector<float> worldY;
+	std::vector<float> worldDepth;
+	std::vector<float> worldScale;
+	std::vector<uint32_t> parents; // Slot of the parent
+	std::vector<uint32_t> levels;
+	std::vector<uint8_t> dirty; // Set for changed transforms, update() spreads it to their children before composing
+	std::vector<uint32_t> handleOfSlot;
+
+	std::vector<uint32_t> slotOfHandle;
+	std::vector<uint32_t> levelStarts; // First slot of every level, the last one runs until the end
+	bool orderDirty = false; // A transform was created on a level that isn't the last one
+	bool anyDirty = false;
+	std::atomic<uint32_t> updatedCount{ 0 };
+
+	void sortByLevel();
+	void updateRange(uint32_t begin, uint32_t end);
+	void writeRange(ObjectInstance *output, uint32_t begin, uint32_t end) const;
+};
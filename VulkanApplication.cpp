@@ -1,4 +1,5 @@
 #include "VulkanApplication.hpp"
+#include "VulkanUtils.hpp"
 
 #include <fstream>
 #include <iostream>
@@ -6,31 +7,396 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <limits>
 
 /*
 * You'll see a lot of variable or functions that ends with KHR
 * KHR are extensions that were approved by KHRonos 
 */ 
 
+void VulkanApplication::enableCapture(const std::string& outputPath, FrameCapture::OutputFormat outputFormat)
+{
+	captureEnabled = true;
+	captureOutputPath = outputPath;
+	captureOutputFormat = outputFormat;
+}
+
+void VulkanApplication::enableHeadless(uint32_t frameCount)
+{
+	headless = true;
+	headlessFrameCount = frameCount;
+
+	// Nothing is presented, a device without the swap chain extension is just as good
+	deviceExtensions.erase(std::remove(deviceExtensions.begin(), deviceExtensions.end(), std::string(VK_KHR_SWAPCHAIN_EXTENSION_NAME)), deviceExtensions.end());
+}
+
+void VulkanApplication::setGpuFrameBudget(double milliseconds)
+{
+	DynamicResolutionSettings settings = dynamicResolution.getSettings();
+	settings.targetFrameTime = milliseconds;
+	dynamicResolution = DynamicResolution(settings);
+}
+
+void VulkanApplication::disableAsyncCompute()
+{
+	asyncComputeAllowed = false;
+}
+
+void VulkanApplication::disableDepthPrepass()
+{
+	depthPrepassEnabled = false;
+}
+
+void VulkanApplication::disableOcclusionCulling()
+{
+	occlusionCullingEnabled = false;
+}
+
+void VulkanApplication::disableHostAllocator()
+{
+	hostAllocator.setEnabled(false);
+}
+
+void VulkanApplication::showHud()
+{
+	hudVisible = true;
+}
+
 void VulkanApplication::run()
 {
-	initGLFW();
-	initVulkan();
-	mainLoop();
+	init();
+	if (headless) {
+		runHeadless();
+	} else {
+		mainLoop();
+	}
 	cleanup();
 }
 
+/*
+* Startup as a dependency graph, each task starts as soon as what it needs is ready
+* - Files (SPIR-V, pipeline cache) are read right away on worker threads
+* - The instance is created and physical devices are queried while the main thread creates the window
+* - The graphics pipeline is compiled as soon as the device exists, in parallel with the swap chain
+* GLFW window functions may only be called from the main thread, those tasks are pinned to it
+* Headless runs leave out GLFW, the window and the surface, an offscreen image is created in place of the swap chain
+*/
+void VulkanApplication::init()
+{
+	using Affinity = TaskGraph::Affinity;
+	TaskGraph& graph = startupTimeline;
+
+	std::vector<TaskHandle> glfwReady;
+	TaskHandle windowCreated = 0;
+	if (!headless) {
+		TaskHandle glfw = graph.addTask("init glfw", [this]() { initGLFW(); }, {}, Affinity::MainThread);
+		windowCreated = graph.addTask("create window", [this]() { createWindow(); }, { glfw }, Affinity::MainThread);
+		glfwReady = { glfw };
+	}
+	TaskHandle shadersLoaded = graph.addTask("load shaders", [this]() { loadShaderCode(); });
+	TaskHandle cacheLoaded = graph.addTask("load pipeline cache", [this]() { loadPipelineCache(); });
+	TaskHandle sceneCreated = graph.addTask("create scene", [this]() { createScene(); });
+
+	TaskHandle instanceCreated = graph.addTask("create instance", [this]() { createInstance(); }, glfwReady);
+	graph.addTask("setup debug messenger", [this]() { setupDebugMessenger(); }, { instanceCreated });
+	TaskHandle devicesEnumerated = graph.addTask("enumerate physical devices", [this]() { enumeratePhysicalDevices(); }, { instanceCreated });
+	std::vector<TaskHandle> devicePickDependencies = { devicesEnumerated };
+	if (!headless) {
+		devicePickDependencies.push_back(graph.addTask("create surface", [this]() { createSurface(); }, { instanceCreated, windowCreated }));
+	}
+	TaskHandle devicePicked = graph.addTask("pick physical device", [this]() { pickPhysicalDevice(); }, devicePickDependencies);
+	TaskHandle deviceCreated = graph.addTask("create logical device", [this]() { createLogicalDevice(); }, { devicePicked });
+
+	TaskHandle swapChainCreated = headless
+		? graph.addTask("create offscreen target", [this]() { createOffscreenTarget(); }, { deviceCreated })
+		: graph.addTask("create swap chain", [this]() { createSwapChain(); }, { deviceCreated });
+	graph.addTask("create image views", [this]() { createImageViews(); }, { swapChainCreated });
+	TaskHandle pipelineCreated = graph.addTask("create graphics pipeline", [this]() { createGraphicsPipeline(); }, { deviceCreated, shadersLoaded, cacheLoaded });
+	TaskHandle postProcessCreated = graph.addTask("create post processing", [this]() { createPostProcessChain(); }, { pipelineCreated });
+	TaskHandle allocatorCreated = graph.addTask("create frame allocator", [this]() { createFrameAllocator(); }, { deviceCreated });
+	graph.addTask("create frame capture", [this]() { createFrameCapture(); }, { swapChainCreated });
+	graph.addTask("create gpu timer", [this]() { createGpuTimer(); }, { deviceCreated });
+	TaskHandle occlusionCreated = graph.addTask("create occlusion culling", [this]() { createOcclusionCuller(); }, { pipelineCreated, swapChainCreated, sceneCreated });
+	TaskHandle hudCreated = graph.addTask("create performance hud", [this]() { createPerformanceHud(); }, { pipelineCreated, swapChainCreated });
+	TaskHandle renderGraphBuilt = graph.addTask("build render graph", [this]() { buildRenderGraph(); },
+		{ swapChainCreated, allocatorCreated, postProcessCreated, occlusionCreated, hudCreated });
+
+	// Both depend on how many submissions the render graph ended up with
+	TaskHandle commandBuffersCreated = graph.addTask("create command buffers", [this]() { createCommandPool(); createCommandBuffers(); }, { renderGraphBuilt });
+	graph.addTask("create sync objects", [this]() { createSyncObjects(); }, { renderGraphBuilt });
+	graph.addTask("initialize gpu resources", [this]() { initializeGpuResources(); }, { commandBuffersCreated });
+
+	graph.run(threadPool);
+}
+
 void VulkanApplication::mainLoop()
 {
+	requestRedraw();
+
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
+
+		// Nothing would change on screen, sleep until the window system has something for us instead of spinning
+		if (!isWindowVisible() || (pendingRedraws == 0 && !captureEnabled && !performanceHud.isVisible())) {
+			glfwWaitEvents();
+			continue;
+		}
+
+		// Events that arrive while waiting still wake the loop up, so input is handled just as quickly
+		if (!windowFocused) {
+			double remaining = lastFrameTime + UNFOCUSED_FRAME_INTERVAL - glfwGetTime();
+			if (remaining > 0.0) {
+				glfwWaitEventsTimeout(remaining);
+				continue;
+			}
+		}
+
+		if (pendingRedraws > 0) {
+			--pendingRedraws;
+		}
+
+		drawFrame();
+		lastFrameTime = glfwGetTime();
+
+		if (!firstFramePresented) {
+			firstFramePresented = true;
+			startupTimeline.markEvent("first frame presented");
+			startupTimeline.printReport();
+		}
+	}
+
+	// Operations in drawFrame are asynchronous, wait for them to finish before cleaning up
+	vkDeviceWaitIdle(device);
+}
+
+// Every frame is rendered back to back, there are no events to wait for and nothing limits the frame rate
+void VulkanApplication::runHeadless()
+{
+	for (uint32_t frame = 0; frame < headlessFrameCount; ++frame) {
+		drawFrame();
+
+		if (!firstFramePresented) {
+			firstFramePresented = true;
+			startupTimeline.markEvent("first frame submitted");
+			startupTimeline.printReport();
+		}
+	}
+
+	vkDeviceWaitIdle(device);
+}
+
+void VulkanApplication::requestRedraw()
+{
+	// A frame's GPU timings are read back MAX_FRAMES_IN_FLIGHT frames later, render enough frames for them to be seen
+	pendingRedraws = MAX_FRAMES_IN_FLIGHT + 1;
+}
+
+bool VulkanApplication::isWindowVisible()
+{
+	// A minimized window can have a 0x0 framebuffer, which no swap chain image can be presented to
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	return !windowIconified && width > 0 && height > 0;
+}
+
+void VulkanApplication::windowRefreshCallback(GLFWwindow *window)
+{
+	// The window system lost the window's contents, e.g. it was uncovered
+	auto app = static_cast<VulkanApplication *>(glfwGetWindowUserPointer(window));
+	app->requestRedraw();
+}
+
+void VulkanApplication::windowFocusCallback(GLFWwindow *window, int focused)
+{
+	auto app = static_cast<VulkanApplication *>(glfwGetWindowUserPointer(window));
+	app->windowFocused = focused == GLFW_TRUE;
+	app->requestRedraw();
+}
+
+void VulkanApplication::windowIconifyCallback(GLFWwindow *window, int iconified)
+{
+	auto app = static_cast<VulkanApplication *>(glfwGetWindowUserPointer(window));
+	app->windowIconified = iconified == GLFW_TRUE;
+	app->requestRedraw();
+}
+
+void VulkanApplication::framebufferSizeCallback(GLFWwindow *window, int width, int height)
+{
+	auto app = static_cast<VulkanApplication *>(glfwGetWindowUserPointer(window));
+	app->requestRedraw();
+}
+
+void VulkanApplication::keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS) {
+		return;
+	}
+
+	auto app = static_cast<VulkanApplication *>(glfwGetWindowUserPointer(window));
+
+	switch (key) {
+	case GLFW_KEY_F1:
+		app->performanceHud.setVisible(!app->performanceHud.isVisible());
+		// The loop was idle, the time since the last frame would show up as one very long frame
+		app->lastDrawTime = std::chrono::steady_clock::now();
+		break;
+	case GLFW_KEY_F2:
+		app->toggleTriangleFeature(TRIANGLE_FEATURE_GRAYSCALE);
+		break;
+	case GLFW_KEY_F3:
+		app->toggleTriangleFeature(TRIANGLE_FEATURE_INVERT);
+		break;
+	case GLFW_KEY_F4:
+		app->cycleContrastIterations();
+		break;
+	default:
+		return;
+	}
+
+	app->requestRedraw();
+}
+
+/*
+* Rendering a frame consists of
+* - Wait for the previous frame that used this frame's resources to finish
+* - Acquire an image from the swap chain
+* - Record a command buffer which draws the scene onto that image
+* - Submit the recorded command buffer
+* - Present the swap chain image
+* Headless there is nothing to acquire or present, every frame renders into the offscreen image
+*/
+void VulkanApplication::drawFrame()
+{
+	auto drawTime = std::chrono::steady_clock::now();
+	double frameMilliseconds = std::chrono::duration<double, std::milli>(drawTime - lastDrawTime).count();
+	lastDrawTime = drawTime;
+
+	// The CPU waits on the timeline until the GPU is done with everything this frame slot submitted last time
+	scheduler.wait(framePoints[currentFrame]);
+
+	// Reads this slot's culling results, which live in the frame allocator region that is about to be reused
+	occlusionCuller.beginFrame(currentFrame);
+
+	// Everything allocated for this frame slot the last time around is no longer in use by the GPU
+	frameAllocator.beginFrame(currentFrame);
+
+	// Captured frames whose copy has finished are handed to worker threads
+	if (captureEnabled) {
+		frameCapture.collect();
+	}
+
+	uint32_t imageIndex = 0;
+	if (!headless) {
+		vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	}
+
+	renderGraph.setImportedImage(backbuffer, swapChainImages[imageIndex], swapChainImageViews[imageIndex]);
+
+	// The render graph is split into a submission every time it switches between the graphics and the compute queue
+	uint32_t submissionCount = renderGraph.getSubmissionCount();
+	uint32_t acquireSubmission = renderGraph.getFirstSubmission(backbuffer);
+	TimelinePoint previousPoint;
+
+	for (uint32_t submission = 0; submission < submissionCount; ++submission) {
+		bool last = submission + 1 == submissionCount;
+		uint32_t queue = renderGraph.getSubmissionQueue(submission) == RenderGraphQueue::Compute ? computeQueueId : graphicsQueueId;
+
+		// Batches are only queued until the flush below, so the point is known while recording
+		recordingPoint = scheduler.getNextPoint(queue);
+
+		VkCommandBuffer commandBuffer = commandBuffers[currentFrame][submission];
+		vkResetCommandBuffer(commandBuffer, 0);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording command buffer!");
+		}
+
+		if (submission == 0) {
+			// Timings of this frame slot's previous use are read back here, which is what the render scale is based on
+			gpuTimer.beginFrame(commandBuffer, currentFrame);
+			updateRenderScale();
+			postProcess.beginFrame(renderExtent);
+
+			// Vertices and objects are written into this frame's slot of the linear allocator, no buffer creation or mapping needed
+			vertexData = frameAllocator.upload(vertices.data(), sizeof(Vertex) * vertices.size(), alignof(Vertex));
+			ObjectInstance* instances = occlusionCuller.prepareDraw(frameAllocator, renderGraph, transforms.getCount(), meshBounds, renderExtent);
+
+			// Only transforms that changed are recomputed, but all of them are written since the slot's previous contents are stale
+			transforms.update(instances, &threadPool);
+
+			// After everything else this frame allocates, so the HUD sees this frame's allocator usage, while hidden this only clears the last draw
+			PerformanceHudStats hudStats;
+			if (performanceHud.isVisible()) {
+				hudStats = gatherHudStats(frameMilliseconds);
+			}
+			performanceHud.prepareDraw(frameAllocator, hudStats);
+
+			// Keep rendering until the exposure has settled, the image would otherwise freeze halfway through adapting
+			if (postProcess.isAdapting()) {
+				requestRedraw();
+			}
+		}
+
+		renderGraph.executeSubmission(submission, commandBuffer);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
+		}
+
+		// Every submission waits on the one before it, that's what orders work across the two queues
+		// The wait covers every stage and every later submission on the queue, the queues don't run in parallel
+		SubmitBatch batch;
+		batch.commandBuffers.push_back(commandBuffer);
+		batch.waitFor(previousPoint, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+		// Don't write to the swap chain image until it's available
+		if (!headless && submission == acquireSubmission) {
+			batch.waitBinary(imageAvailableSemaphores[currentFrame], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+		}
+
+		// Presentation can't wait on a timeline semaphore
+		if (!headless && last) {
+			batch.signalBinary(renderFinishedSemaphores[imageIndex], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+		}
+
+		previousPoint = scheduler.submit(queue, batch);
 	}
+
+	// The last submission can't finish before the ones it waits on, so its point stands for the whole frame
+	framePoints[currentFrame] = previousPoint;
+	scheduler.flush();
+
+	if (headless) {
+		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		return;
+	}
+
+	VkSemaphore presentWaitSemaphore = renderFinishedSemaphores[imageIndex];
+
+	VkPresentInfoKHR presentInfo{};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &presentWaitSemaphore;
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &swapChain;
+	presentInfo.pImageIndices = &imageIndex;
+
+	vkQueuePresentKHR(presentQueue, &presentInfo);
+
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
 void VulkanApplication::cleanup()
 {
 	cleanupVulkan();
-	cleanupGLFW();
+	if (!headless) {
+		cleanupGLFW();
+	}
 }
 
 
@@ -40,8 +406,19 @@ void VulkanApplication::initGLFW()
 
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // GLFW by default initializes with OpenGL context, this informs it not to.
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // Disable resizable window
+}
 
+void VulkanApplication::createWindow()
+{
 	window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr); // Create window
+
+	// Callbacks are static, the user pointer is how they get back to the application
+	glfwSetWindowUserPointer(window, this);
+	glfwSetWindowRefreshCallback(window, windowRefreshCallback);
+	glfwSetWindowFocusCallback(window, windowFocusCallback);
+	glfwSetWindowIconifyCallback(window, windowIconifyCallback);
+	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+	glfwSetKeyCallback(window, keyCallback);
 }
 
 void VulkanApplication::cleanupGLFW()
@@ -50,32 +427,67 @@ void VulkanApplication::cleanupGLFW()
 	glfwTerminate();
 }
 
-void VulkanApplication::initVulkan()
-{
-	createInstance();
-	setupDebugMessenger();
-	createSurface();
-	pickPhysicalDevice();
-	createLogicalDevice();
-	createSwapChain();
-	createImageViews();
-}
-
 void VulkanApplication::cleanupVulkan()
 {
+	renderGraph.destroy();
+	frameAllocator.destroy();
+	gpuTimer.printReport();
+	gpuTimer.destroy();
+
+	if (captureEnabled) {
+		frameCapture.destroy();
+	}
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+		vkDestroySemaphore(device, imageAvailableSemaphores[i], hostAllocator.getCallbacks());
+	}
+	for (auto semaphore : renderFinishedSemaphores) {
+		vkDestroySemaphore(device, semaphore, hostAllocator.getCallbacks());
+	}
+
+	scheduler.printReport();
+	scheduler.destroy();
+
+	vkDestroyCommandPool(device, commandPool, hostAllocator.getCallbacks());
+	if (computeCommandPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(device, computeCommandPool, hostAllocator.getCallbacks());
+	}
+
+	postProcess.destroy();
+	occlusionCuller.printReport();
+	occlusionCuller.destroy();
+	performanceHud.destroy();
+
+	// Keep what the driver compiled this run for the next one
+	writeFile(pipelineCacheFile, pipelineVariants.getCacheData());
+	pipelineVariants.printReport();
+	pipelineVariants.destroy();
+
+	vkDestroyShaderModule(device, fragShaderModule, hostAllocator.getCallbacks());
+	vkDestroyShaderModule(device, vertShaderModule, hostAllocator.getCallbacks());
+	vkDestroyPipelineLayout(device, pipelineLayout, hostAllocator.getCallbacks());
+
 	for (auto imageView : swapChainImageViews) {
-		vkDestroyImageView(device, imageView, nullptr);
+		vkDestroyImageView(device, imageView, hostAllocator.getCallbacks());
 	}
 
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
-	vkDestroyDevice(device, nullptr);
+	if (headless) {
+		vkDestroyImage(device, offscreenImage, hostAllocator.getCallbacks());
+		vkFreeMemory(device, offscreenImageMemory, hostAllocator.getCallbacks());
+	} else {
+		vkDestroySwapchainKHR(device, swapChain, hostAllocator.getCallbacks());
+		vkDestroySurfaceKHR(instance, surface, hostAllocator.getCallbacks());
+	}
+	vkDestroyDevice(device, hostAllocator.getCallbacks());
 
 	if (enableValidationLayers) {
-		destroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+		destroyDebugUtilsMessengerEXT(instance, debugMessenger, hostAllocator.getCallbacks());
 	}
 
-	vkDestroyInstance(instance, nullptr);
+	vkDestroyInstance(instance, hostAllocator.getCallbacks());
+
+	// After the instance is gone, anything still live was leaked
+	hostAllocator.printReport();
 }
 
 void VulkanApplication::createInstance()
@@ -92,7 +504,7 @@ void VulkanApplication::createInstance()
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_3; // Required for synchronization2 and dynamic rendering used by the render graph
 
 
 	VkInstanceCreateInfo createInfo{};
@@ -119,7 +531,7 @@ void VulkanApplication::createInstance()
 		createInfo.pNext = nullptr;
 	}
 
-	if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+	if (vkCreateInstance(&createInfo, hostAllocator.getCallbacks(), &instance) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create vulkan instance!");
 	}
 }
@@ -128,9 +540,9 @@ std::vector<const char*> VulkanApplication::getRequiredInstanceExtensions()
 {
 	// Vulkan is platform agnostic API
 	// As such we need a extension to interface with the window system
-	// GLFW is able to provide what extensions are required
+	// GLFW is able to provide what extensions are required, headless there is no window system to interface with
 	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	const char** glfwExtensions = headless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
 
@@ -208,7 +620,7 @@ void VulkanApplication::setupDebugMessenger()
 	VkDebugUtilsMessengerCreateInfoEXT createInfo;
 	populateDebugMessengerCreateInfo(createInfo);
 
-	if (createDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+	if (createDebugUtilsMessengerEXT(instance, &createInfo, hostAllocator.getCallbacks(), &debugMessenger) != VK_SUCCESS) {
 		throw std::runtime_error("failed to setup debug messenger!");
 	}
 }
@@ -273,12 +685,12 @@ VkBool32 VulkanApplication::debugCallback(
 
 void VulkanApplication::createSurface()
 {
-	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+	if (glfwCreateWindowSurface(instance, window, hostAllocator.getCallbacks(), &surface) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create window surface!");
 	}
 }
 
-void VulkanApplication::pickPhysicalDevice()
+void VulkanApplication::enumeratePhysicalDevices()
 {
 	uint32_t deviceCount = 0;
 	// First grab the count of physical devices
@@ -291,21 +703,36 @@ void VulkanApplication::pickPhysicalDevice()
 	std::vector<VkPhysicalDevice> devices(deviceCount);
 	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-
-	// Sorted map to automatically sort candidates on insert
-	std::multimap<int, VkPhysicalDevice> candidates;
-
+	// deviceCandidates is a sorted map, candidates are sorted by score on insert
 	for (const auto& device : devices) {
 		int score = rateDeviceSuitability(device);
-		candidates.insert(std::pair<int, VkPhysicalDevice>(score, device));
+
+		// Score of 0 means the device is missing something the application requires
+		if (score > 0) {
+			deviceCandidates.insert(std::pair<int, VkPhysicalDevice>(score, device));
+		}
 	}
+}
 
-	// Checks if the score is more than 0
-	if (candidates.rbegin()->first > 0) {
-		physicalDevice = candidates.rbegin()->second; // Assign the device in the map
-	} else {
+void VulkanApplication::pickPhysicalDevice()
+{
+	// Go through the candidates from the highest score down, picking the first one that can present to the surface
+	for (auto it = deviceCandidates.rbegin(); it != deviceCandidates.rend(); ++it) {
+		if (isDeviceSurfaceCompatible(it->second)) {
+			physicalDevice = it->second;
+			break;
+		}
+	}
+
+	if (physicalDevice == VK_NULL_HANDLE) {
 		throw std::runtime_error("failed to find a suitable GPU!");
 	}
+
+	if (headless) {
+		surfaceFormat = { OFFSCREEN_FORMAT, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	} else {
+		surfaceFormat = chooseSwapSurfaceFormat(querySwapChainSupport(physicalDevice).formats);
+	}
 }
 
 int VulkanApplication::rateDeviceSuitability(VkPhysicalDevice device)
@@ -331,26 +758,46 @@ int VulkanApplication::rateDeviceSuitability(VkPhysicalDevice device)
 		return 0;
 	}
 
-	// Check if device has extensions required supported
-	if (!checkDeviceExtensionSupport(device)) {
+	// Render graph records its barriers with synchronization2 and passes render through dynamic rendering, both are core in Vulkan 1.3
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_3) {
 		return 0;
 	}
 
-	// Check if device supports swap chain
-	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-	if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures2{};
+	deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures2.pNext = &vulkan13Features;
+	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+
+	if (!vulkan13Features.synchronization2 || !vulkan13Features.dynamicRendering) {
 		return 0;
 	}
 
-	// Check device has all queue families supported
-	QueueFamilyIndices indices = findQueueFamilies(device);
-	if (!indices.isComplete()) {
+	// Check if device has extensions required supported
+	if (!checkDeviceExtensionSupport(device)) {
 		return 0;
 	}
 
 	return score;
 }
 
+bool VulkanApplication::isDeviceSurfaceCompatible(VkPhysicalDevice device)
+{
+	// Check if device supports swap chain, without a surface there's nothing to check
+	if (!headless) {
+		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+		if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
+			return false;
+		}
+	}
+
+	// Check device has all queue families supported
+	QueueFamilyIndices indices = findQueueFamilies(device);
+	return indices.isComplete();
+}
+
 QueueFamilyIndices VulkanApplication::findQueueFamilies(VkPhysicalDevice device)
 {
 	QueueFamilyIndices indices;
@@ -366,11 +813,16 @@ QueueFamilyIndices VulkanApplication::findQueueFamilies(VkPhysicalDevice device)
 			indices.graphicsFamily = i;
 		}
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		// Nothing is presented headless, the graphics family stands in so the rest of the setup doesn't need to care
+		if (headless) {
+			indices.presentFamily = indices.graphicsFamily;
+		} else {
+			VkBool32 presentSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-		if (presentSupport) {
-			indices.presentFamily = i;
+			if (presentSupport) {
+				indices.presentFamily = i;
+			}
 		}
 
 		if (indices.isComplete()) {
@@ -378,6 +830,14 @@ QueueFamilyIndices VulkanApplication::findQueueFamilies(VkPhysicalDevice device)
 		}
 	}
 
+	// A family without graphics support is usually backed by separate hardware queues, so compute work there runs in parallel
+	for (unsigned int i = 0; i < queueFamilyCount; ++i) {
+		if ((queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.computeFamily = i;
+			break;
+		}
+	}
+
 	return indices;
 }
 
@@ -400,10 +860,18 @@ bool VulkanApplication::checkDeviceExtensionSupport(VkPhysicalDevice device)
 
 void VulkanApplication::createLogicalDevice()
 {
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	queueFamilies = findQueueFamilies(physicalDevice);
+	if (!asyncComputeAllowed) {
+		queueFamilies.computeFamily.reset();
+	}
+	asyncComputeEnabled = queueFamilies.computeFamily.has_value();
+	QueueFamilyIndices indices = queueFamilies;
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	if (asyncComputeEnabled) {
+		uniqueQueueFamilies.insert(indices.computeFamily.value());
+	}
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -418,8 +886,32 @@ void VulkanApplication::createLogicalDevice()
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
 
+	// Features that are newer than Vulkan 1.0 are enabled through structs chained in pNext
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.synchronization2 = VK_TRUE;
+	vulkan13Features.dynamicRendering = VK_TRUE;
+
+	// Buffer device address lets shaders read per-frame data through a pointer instead of a descriptor, optional
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 supportedFeatures{};
+	supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures.pNext = &supportedVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+	bufferDeviceAddressEnabled = supportedVulkan12Features.bufferDeviceAddress == VK_TRUE;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.bufferDeviceAddress = bufferDeviceAddressEnabled ? VK_TRUE : VK_FALSE;
+	vulkan12Features.timelineSemaphore = VK_TRUE; // Required to be supported since Vulkan 1.2, the submission scheduler is built on it
+	vulkan13Features.pNext = &vulkan12Features;
+
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &vulkan13Features;
 
 	// Set queues
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
@@ -444,18 +936,27 @@ void VulkanApplication::createLogicalDevice()
 
 	// Notice how it's quite similar to instantiating instance
 	// Only difference is that these features are device specific now
-	if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+	if (vkCreateDevice(physicalDevice, &createInfo, hostAllocator.getCallbacks(), &device) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create logical device!");
 	}
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+	if (asyncComputeEnabled) {
+		vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &computeQueue);
+	}
+
+	scheduler.create(device, hostAllocator.getCallbacks());
+	graphicsQueueId = scheduler.addQueue(graphicsQueue, "graphics");
+	if (asyncComputeEnabled) {
+		computeQueueId = scheduler.addQueue(computeQueue, "compute");
+	}
 }
 
 void VulkanApplication::createSwapChain()
 {
+	// The surface format was already chosen in pickPhysicalDevice
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
-	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
 	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 	VkExtent2D swapExtent = chooseSwapExtent(swapChainSupport.capabilities);
 	
@@ -486,7 +987,21 @@ void VulkanApplication::createSwapChain()
 	// VK_IMAGE_USAGE_TRANS_DST_BIT can be used for post-processing an image and use a memory operation to transfer the rendered image to a swap chain image
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	// Frame capture copies the presented image into a readback buffer, so it has to be a transfer source
+	if (captureEnabled) {
+		if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+			throw std::runtime_error("swap chain images can't be used as a transfer source, frame capture is not supported!");
+		}
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+
+	// The scene is rendered at a dynamic resolution and blitted onto the swap chain image
+	if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+		throw std::runtime_error("swap chain images can't be used as a transfer destination!");
+	}
+	createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	QueueFamilyIndices indices = queueFamilies;
 	uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
 
 	// Image Sharing Mode indicates how an image is shared between different queues
@@ -520,7 +1035,7 @@ void VulkanApplication::createSwapChain()
 	// Ignore for now
 	createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+	if (vkCreateSwapchainKHR(device, &createInfo, hostAllocator.getCallbacks(), &swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
 	}
 
@@ -532,6 +1047,46 @@ void VulkanApplication::createSwapChain()
 	swapChainExtent = createInfo.imageExtent;
 }
 
+void VulkanApplication::createOffscreenTarget()
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = surfaceFormat.format;
+	imageInfo.extent = { WIDTH, HEIGHT, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// Same usage the swap chain images get, transfer source is what frame capture reads it with
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+	if (vkCreateImage(device, &imageInfo, hostAllocator.getCallbacks(), &offscreenImage) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create offscreen image!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, offscreenImage, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, hostAllocator.getCallbacks(), &offscreenImageMemory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate offscreen image memory!");
+	}
+
+	vkBindImageMemory(device, offscreenImage, offscreenImageMemory, 0);
+
+	swapChainImages = { offscreenImage };
+	swapChainImageFormat = imageInfo.format;
+	swapChainExtent = { WIDTH, HEIGHT };
+}
+
 SwapChainSupportDetails VulkanApplication::querySwapChainSupport(VkPhysicalDevice device)
 {
 	SwapChainSupportDetails details{};
@@ -648,7 +1203,7 @@ void VulkanApplication::createImageViews()
 		createInfo.subresourceRange.baseArrayLayer = 0;
 		createInfo.subresourceRange.layerCount = 1;
 
-		if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
+		if (vkCreateImageView(device, &createInfo, hostAllocator.getCallbacks(), &swapChainImageViews[i]) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create image views!");
 		}
 	}
@@ -656,12 +1211,109 @@ void VulkanApplication::createImageViews()
 
 void VulkanApplication::createGraphicsPipeline()
 {
-	auto vertShaderCode = readFile("shaders/vert.spv");
-	auto fragShaderCode = readFile("shaders/frag.spv");
+	// Shader modules are kept around as every variant of the pipeline is built from the same SPIR-V
+	// The SPIR-V itself was already read from disk by loadShaderCode
+	vertShaderModule = createShaderModule(vertShaderCode);
+	fragShaderModule = createShaderModule(fragShaderCode);
+	vertShaderCode.clear();
+	fragShaderCode.clear();
+
+	depthFormat = findDepthFormat();
+
+	/* PIPELINE LAYOUT */
+	// Describes the uniform values (descriptor sets and push constants) that the shaders can access, none for now
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 0;
+	pipelineLayoutInfo.pushConstantRangeCount = 0;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, hostAllocator.getCallbacks(), &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	// A cache saved by a previous run lets the driver skip compiling variants it has already seen
+	pipelineVariants.create(device, physicalDevice, pipelineCacheData, hostAllocator.getCallbacks());
+	pipelineCacheData.clear();
+
+	// Build the variant used by the first frame up front instead of in the middle of recording it
+	getGraphicsPipeline();
+	if (depthPrepassEnabled) {
+		getDepthPipeline();
+	}
+}
+
+void VulkanApplication::loadShaderCode()
+{
+	vertShaderCode = readFile("shaders/vert.spv");
+	fragShaderCode = readFile("shaders/frag.spv");
+
+	postShaderCode.luminanceHistogram = readFile("shaders/luminance_histogram.spv");
+	postShaderCode.exposure = readFile("shaders/exposure.spv");
+	postShaderCode.exposureSubgroup = readFile("shaders/exposure_subgroup.spv");
+	postShaderCode.bloomDownsample = readFile("shaders/bloom_downsample.spv");
+	postShaderCode.bloomUpsample = readFile("shaders/bloom_upsample.spv");
+	postShaderCode.tonemap = readFile("shaders/tonemap.spv");
+
+	occlusionShaderCode.hiZBuild = readFile("shaders/hiz_build.spv");
+	occlusionShaderCode.occlusionCull = readFile("shaders/occlusion_cull.spv");
+
+	hudShaderCode.vertex = readFile("shaders/hud_vert.spv");
+	hudShaderCode.fragment = readFile("shaders/hud_frag.spv");
+}
 
-	VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+void VulkanApplication::loadPipelineCache()
+{
+	try {
+		pipelineCacheData = readFile(pipelineCacheFile);
+	}
+	catch (const std::runtime_error&) {
+		// First run, nothing cached yet
+	}
+}
 
+VkPipeline VulkanApplication::getGraphicsPipeline()
+{
+	return pipelineVariants.get("triangle", triangleVariant, [this](const ShaderVariantKey& key, const VkSpecializationInfo* specializationInfo, VkPipelineCache pipelineCache) {
+		return buildGraphicsPipeline(specializationInfo, pipelineCache, false);
+	});
+}
+
+// The next frame looks the new key up, the first use of a combination builds its pipeline while recording
+void VulkanApplication::toggleTriangleFeature(TriangleShaderFeature feature)
+{
+	uint32_t featureBits = triangleVariant.get(TRIANGLE_FEATURE_BITS, 0);
+	triangleVariant.set(TRIANGLE_FEATURE_BITS, featureBits ^ feature);
+	printTriangleVariant();
+}
+
+void VulkanApplication::cycleContrastIterations()
+{
+	uint32_t iterations = triangleVariant.get(TRIANGLE_CONTRAST_ITERATIONS, 0);
+	triangleVariant.set(TRIANGLE_CONTRAST_ITERATIONS, (iterations + 1) % (MAX_CONTRAST_ITERATIONS + 1));
+	printTriangleVariant();
+}
+
+void VulkanApplication::printTriangleVariant()
+{
+	uint32_t featureBits = triangleVariant.get(TRIANGLE_FEATURE_BITS, 0);
+
+	std::cout << "shader variant: grayscale " << ((featureBits & TRIANGLE_FEATURE_GRAYSCALE) ? "on" : "off")
+		<< ", invert " << ((featureBits & TRIANGLE_FEATURE_INVERT) ? "on" : "off")
+		<< ", contrast iterations " << triangleVariant.get(TRIANGLE_CONTRAST_ITERATIONS, 0) << std::endl;
+}
+
+VkPipeline VulkanApplication::getDepthPipeline()
+{
+	// The fragment shader's specialization constants don't apply, so there is only ever one variant
+	return pipelineVariants.get("depth prepass", ShaderVariantKey{}, [this](const ShaderVariantKey& key, const VkSpecializationInfo* specializationInfo, VkPipelineCache pipelineCache) {
+		return buildGraphicsPipeline(specializationInfo, pipelineCache, true);
+	});
+}
+
+// Builds one variant of the triangle pipeline, specializationInfo holds the values of the shaders' specialization constants
+// depthOnly builds the pipeline of the depth pre-pass instead, which has no fragment shader and no color attachment
+VkPipeline VulkanApplication::buildGraphicsPipeline(const VkSpecializationInfo* specializationInfo, VkPipelineCache pipelineCache, bool depthOnly)
+{
 	// Create Vertex Shader Stage pipeline
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -675,6 +1327,7 @@ void VulkanApplication::createGraphicsPipeline()
 	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
+	fragShaderStageInfo.pSpecializationInfo = specializationInfo;
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
@@ -689,12 +1342,22 @@ void VulkanApplication::createGraphicsPipeline()
 	* Bindings, spacing between data and whether the data is per-vertex or per-instance
 	* Attribute Descriptions, type of the attributes passed to the vertex shader, which binding to load them from and at which offset
 	*/
+	// Binding 0 is the mesh, binding 1 the objects it is instanced for
+	std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = { Vertex::getBindingDescription(), ObjectInstance::getBindingDescription() };
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	for (const auto& attribute : Vertex::getAttributeDescriptions()) {
+		attributeDescriptions.push_back(attribute);
+	}
+	for (const auto& attribute : ObjectInstance::getAttributeDescriptions()) {
+		attributeDescriptions.push_back(attribute);
+	}
+
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	/* INPUT ASSEMBLY */
 	/* Describes what kind of geometry will be drawn from the vertices and if primitive restart should be enabled
@@ -713,27 +1376,15 @@ void VulkanApplication::createGraphicsPipeline()
 
 	/* VIEWPORT */
 	// Describes the region of the framebuffer that the output will be rendered to
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)swapChainExtent.width;
-	viewport.height = (float)swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
 	// A Scissor rectangle define in which regions pixels will actually be stored
-	// Any pixels outside will be discarded by the rasterizer
-	// They function like a filter rather than a transformation
-	VkRect2D scissor{};
-	scissor.offset = { 0,0 };
-	scissor.extent = swapChainExtent;
-
+	// Both are dynamic states set by drawScene, only their count is part of the pipeline
+	// That also keeps the pipeline independent of the swap chain, which is created in parallel with it
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
+	viewportState.pViewports = nullptr;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+	viewportState.pScissors = nullptr;
 
 	/* RASTERIZER */
 	VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -767,6 +1418,18 @@ void VulkanApplication::createGraphicsPipeline()
 	multisampling.alphaToCoverageEnable = VK_FALSE;
 	multisampling.alphaToOneEnable = VK_FALSE;
 
+	/* DEPTH */
+	// The pre-pass already wrote the closest depth, so the color pass only shades fragments that match it exactly
+	// Without a pre-pass the color pass does the usual closest-wins test itself
+	bool depthEqual = depthPrepassEnabled && !depthOnly;
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = depthEqual ? VK_FALSE : VK_TRUE;
+	depthStencil.depthCompareOp = depthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
 	/* COLOR BLENDING */
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -778,8 +1441,46 @@ void VulkanApplication::createGraphicsPipeline()
 	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
 	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = depthOnly ? 0 : 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	/* DYNAMIC RENDERING */
+	// Instead of a render pass object, the pipeline only needs to know the formats of the attachments it renders into
+	// The attachments themselves are provided by the render graph when the pass begins rendering
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = depthOnly ? 0 : 1;
+	VkFormat colorFormat = PostProcessChain::COLOR_FORMAT; // The scene is rendered in HDR and tonemapped afterwards
+	renderingInfo.pColorAttachmentFormats = &colorFormat;
+	renderingInfo.depthAttachmentFormat = depthFormat;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &renderingInfo;
+	pipelineInfo.stageCount = depthOnly ? 1 : 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.renderPass = VK_NULL_HANDLE;
+	pipelineInfo.subpass = 0;
+
+	VkPipeline graphicsPipeline;
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, hostAllocator.getCallbacks(), &graphicsPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+
+	return graphicsPipeline;
 }
 
 VkShaderModule VulkanApplication::createShaderModule(const std::vector<char>& code)
@@ -791,30 +1492,477 @@ VkShaderModule VulkanApplication::createShaderModule(const std::vector<char>& co
 
 	VkShaderModule shaderModule;
 
-	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+	if (vkCreateShaderModule(device, &createInfo, hostAllocator.getCallbacks(), &shaderModule) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create shader module!");
 	}
 
 	return shaderModule;
 }
 
-std::vector<char> VulkanApplication::readFile(const std::string& filename)
+void VulkanApplication::createCommandPool()
 {
-	// std;:ios::ate, start reading at the end of the file
-	// std::ios::binary, read the file as binary
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	// VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT allows command buffers to be re-recorded individually every frame
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamilies.graphicsFamily.value();
+
+	if (vkCreateCommandPool(device, &poolInfo, hostAllocator.getCallbacks(), &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create command pool!");
+	}
+
+	// Command buffers can only be submitted to queues of the family their pool was created for
+	if (asyncComputeEnabled) {
+		poolInfo.queueFamilyIndex = queueFamilies.computeFamily.value();
 
-	if (!file.is_open()) {
-		throw std::runtime_error("failed to open file!");
+		if (vkCreateCommandPool(device, &poolInfo, hostAllocator.getCallbacks(), &computeCommandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute command pool!");
+		}
 	}
+}
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
+void VulkanApplication::createCommandBuffers()
+{
+	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
+	for (auto& frameCommandBuffers : commandBuffers) {
+		frameCommandBuffers.resize(renderGraph.getSubmissionCount());
 
-	file.close();
-	
-	return buffer;
+		for (uint32_t submission = 0; submission < frameCommandBuffers.size(); ++submission) {
+			bool compute = renderGraph.getSubmissionQueue(submission) == RenderGraphQueue::Compute;
+
+			// Primary command buffers can be submitted to a queue, secondary ones can only be called from primary command buffers
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = compute ? computeCommandPool : commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device, &allocInfo, &frameCommandBuffers[submission]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate command buffers!");
+			}
+		}
+	}
+}
+
+void VulkanApplication::createSyncObjects()
+{
+	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+	renderFinishedSemaphores.resize(swapChainImages.size());
+
+	// Frames that haven't been submitted yet have an invalid point, which counts as reached so the first frames don't wait
+	framePoints.resize(MAX_FRAMES_IN_FLIGHT);
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+		if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.getCallbacks(), &imageAvailableSemaphores[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create synchronization objects for a frame!");
+		}
+	}
+
+	for (size_t i = 0; i < renderFinishedSemaphores.size(); ++i) {
+		if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.getCallbacks(), &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create synchronization objects for a frame!");
+		}
+	}
+}
+
+void VulkanApplication::createFrameAllocator()
+{
+	frameAllocator.create(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, FRAME_ALLOCATOR_SIZE, bufferDeviceAddressEnabled, hostAllocator.getCallbacks());
+}
+
+void VulkanApplication::createFrameCapture()
+{
+	if (captureEnabled) {
+		frameCapture.create(device, physicalDevice, scheduler, captureOutputPath, captureOutputFormat, swapChainExtent, swapChainImageFormat, CAPTURE_RING_SIZE,
+			hostAllocator.getCallbacks());
+	}
+}
+
+void VulkanApplication::createGpuTimer()
+{
+	std::vector<uint32_t> timedQueueFamilies = { queueFamilies.graphicsFamily.value() };
+	if (asyncComputeEnabled) {
+		timedQueueFamilies.push_back(queueFamilies.computeFamily.value());
+	}
+
+	gpuTimer.create(device, physicalDevice, timedQueueFamilies, MAX_FRAMES_IN_FLIGHT, MAX_GPU_TIMER_SCOPES, hostAllocator.getCallbacks());
+
+	if (!gpuTimer.isSupported()) {
+		std::cout << "timestamps are not supported, rendering at a fixed resolution" << std::endl;
+	}
+}
+
+// The measured time is of the frame rendered MAX_FRAMES_IN_FLIGHT frames ago, DynamicResolution accounts for that lag
+void VulkanApplication::updateRenderScale()
+{
+	// Summed over the passes rather than measured from the first to the last command of the frame
+	// That span would include waiting for the swap chain image, which with FIFO presentation is mostly waiting for vsync,
+	// and the gaps while one queue waits on the other, neither of which a lower resolution makes any shorter
+	double gpuFrameTime = gpuTimer.getTotalMilliseconds();
+
+	if (gpuFrameTime >= 0.0 && dynamicResolution.update(gpuFrameTime)) {
+		requestRedraw();
+
+		VkExtent2D extent = dynamicResolution.getRenderExtent(swapChainExtent);
+		std::cout << "dynamic resolution: scale " << dynamicResolution.getScale() << " (" << extent.width << "x" << extent.height << "), "
+			<< "gpu frame time " << dynamicResolution.getAverageFrameTime() << " ms" << std::endl;
+	}
+
+	renderExtent = dynamicResolution.getRenderExtent(swapChainExtent);
+}
+
+void VulkanApplication::createPostProcessChain()
+{
+	// Compute pipelines go through the same pipeline cache as the graphics pipeline variants
+	postProcess.create(device, physicalDevice, postShaderCode, pipelineVariants.getPipelineCache(), {}, hostAllocator.getCallbacks());
+	postShaderCode = {};
+
+	std::cout << "post processing: " << (asyncComputeEnabled ? "async compute queue" : "graphics queue")
+		<< ", exposure reduced with " << (postProcess.isUsingSubgroups() ? "subgroup arithmetic" : "shared memory") << std::endl;
+}
+
+void VulkanApplication::createScene()
+{
+	meshBounds = glm::vec4(vertices[0].pos, vertices[0].pos);
+	for (const Vertex& vertex : vertices) {
+		meshBounds = glm::vec4(glm::min(glm::vec2(meshBounds), vertex.pos), glm::max(glm::vec2(meshBounds.z, meshBounds.w), vertex.pos));
+	}
+
+	// One large triangle close to the camera in front of a grid of small ones, most of the grid ends up hidden behind it
+	transforms.create({ glm::vec2(0.0f, 0.1f), 0.1f, 1.6f });
+
+	// Every row of the grid hangs off its first triangle, the others are placed relative to it so moving it moves the row
+	const uint32_t gridSize = 24;
+	const float cellScale = 0.06f;
+	for (uint32_t y = 0; y < gridSize; ++y) {
+		TransformHandle row = TransformSystem::INVALID_TRANSFORM;
+		glm::vec2 rowPosition;
+		float rowDepth = 0.0f;
+
+		for (uint32_t x = 0; x < gridSize; ++x) {
+			glm::vec2 position = glm::vec2(x, y) / static_cast<float>(gridSize - 1) * 1.9f - 0.95f;
+			float depth = 0.5f + 0.4f * static_cast<float>((x + y) % 5) / 4.0f;
+
+			if (x == 0) {
+				row = transforms.create({ position, depth, cellScale });
+				rowPosition = position;
+				rowDepth = depth;
+			}
+			else {
+				transforms.create({ (position - rowPosition) / cellScale, depth - rowDepth, 1.0f }, row);
+			}
+		}
+	}
+}
+
+// Picks a depth-only format that can be rendered to and sampled by the depth pyramid build
+VkFormat VulkanApplication::findDepthFormat()
+{
+	const std::vector<VkFormat> candidates = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM };
+	const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+
+	for (VkFormat format : candidates) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+		if ((properties.optimalTilingFeatures & features) == features) {
+			return format;
+		}
+	}
+
+	throw std::runtime_error("failed to find supported depth format!");
+}
+
+void VulkanApplication::createOcclusionCuller()
+{
+	// The pyramid is sized for the largest render scale, like the scene's render targets
+	occlusionCuller.create(device, physicalDevice, occlusionShaderCode, pipelineVariants.getPipelineCache(),
+		dynamicResolution.getMaxExtent(swapChainExtent), MAX_FRAMES_IN_FLIGHT, hostAllocator.getCallbacks());
+	occlusionCuller.setOcclusionEnabled(occlusionCullingEnabled);
+	occlusionShaderCode = {};
+
+	std::cout << "occlusion culling: " << transforms.getCount() << " objects, " << (occlusionCullingEnabled ? "hi-z" : "view only")
+		<< ", depth pre-pass " << (depthPrepassEnabled ? "on" : "off") << std::endl;
+}
+
+// The pyramid has to be cleared and the font atlas uploaded before the first frame samples them, that's a one off submission
+void VulkanApplication::initializeGpuResources()
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate command buffers!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording command buffer!");
+	}
+
+	occlusionCuller.initialize(commandBuffer);
+	performanceHud.initialize(commandBuffer);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
+	}
+
+	SubmitBatch batch;
+	batch.commandBuffers.push_back(commandBuffer);
+	TimelinePoint initialized = scheduler.submit(graphicsQueueId, batch);
+	scheduler.flush();
+	scheduler.wait(initialized);
+
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	performanceHud.releaseUploadBuffer();
+}
+
+void VulkanApplication::createPerformanceHud()
+{
+	performanceHud.create(device, physicalDevice, hudShaderCode, pipelineVariants.getPipelineCache(), swapChainImageFormat, hostAllocator.getCallbacks());
+	performanceHud.setVisible(hudVisible);
+	hudShaderCode = {};
+}
+
+PerformanceHudStats VulkanApplication::gatherHudStats(double frameMilliseconds)
+{
+	PerformanceHudStats stats;
+	stats.frameMilliseconds = frameMilliseconds;
+	stats.gpuMilliseconds = gpuTimer.getTotalMilliseconds();
+	stats.gpuScopes = &gpuTimer.getResults();
+	stats.renderExtent = renderExtent;
+
+	HostAllocator::ScopeStats hostStats = hostAllocator.getTotalStats();
+	stats.hostLiveBytes = hostStats.liveBytes;
+	stats.hostPeakBytes = hostStats.peakBytes;
+
+	stats.frameAllocatorPeak = frameAllocator.getPeakUsage();
+	stats.frameAllocatorSize = FRAME_ALLOCATOR_SIZE;
+	stats.transientBytes = renderGraph.getStatistics().transientBytesAllocated;
+	stats.objectCount = transforms.getCount();
+	stats.culledCount = occlusionCuller.getCulledCount();
+	return stats;
+}
+
+void VulkanApplication::buildRenderGraph()
+{
+	RenderGraphImageDesc backbufferDesc{};
+	backbufferDesc.format = swapChainImageFormat;
+	backbufferDesc.extent = swapChainExtent;
+
+	// The swap chain image's previous contents are discarded, the acquire semaphore is waited on at the color attachment stage
+	RenderGraphImageState acquiredState{};
+	acquiredState.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	acquiredState.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	acquiredState.accessMask = VK_ACCESS_2_NONE;
+	RenderGraphAccess finalAccess = RenderGraphAccess::Present;
+
+	// The offscreen image is shared by every frame in flight, nothing waits for the previous frame's copy out of it
+	// All of its uses are on the graphics queue, so waiting on all earlier commands in the first barrier orders them
+	if (headless) {
+		acquiredState.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		finalAccess = RenderGraphAccess::TransferRead;
+	}
+
+	backbuffer = renderGraph.importImage("backbuffer", backbufferDesc, acquiredState, finalAccess);
+
+	// Sized for the largest render scale, every frame only renders into the top left renderExtent of it
+	RenderGraphImageDesc sceneDesc{};
+	sceneDesc.format = PostProcessChain::COLOR_FORMAT;
+	sceneDesc.extent = dynamicResolution.getMaxExtent(swapChainExtent);
+	sceneColor = renderGraph.createImage("scene color", sceneDesc);
+
+	// Blitting with linear filtering is optional for a format, nearest still works but looks blocky
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, PostProcessChain::COLOR_FORMAT, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT)) {
+		throw std::runtime_error("post processing format can't be used as a blit source!");
+	}
+	upscaleFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	// Same size as the scene color, the pyramid build only reads its top left renderExtent as well
+	RenderGraphImageDesc depthDesc{};
+	depthDesc.format = depthFormat;
+	depthDesc.extent = sceneDesc.extent;
+	depthDesc.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	sceneDepth = renderGraph.createImage("scene depth", depthDesc);
+
+	hiZPyramid = occlusionCuller.importPyramid(renderGraph);
+	occlusionCuller.addCullPass(renderGraph);
+
+	// Both scene passes draw the visible objects with the indirect command the culling pass wrote
+	RenderGraphResource culledDrawCommand = occlusionCuller.getDrawCommandResource();
+	RenderGraphResource visibleObjects = occlusionCuller.getVisibleObjectsResource();
+
+	if (depthPrepassEnabled) {
+		renderGraph.addPass("depth prepass")
+			.read(culledDrawCommand, RenderGraphAccess::IndirectCommandRead)
+			.read(visibleObjects, RenderGraphAccess::VertexAttributeRead)
+			.write(sceneDepth, RenderGraphAccess::DepthAttachmentWrite)
+			.setExecute([this](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+				VkRenderingAttachmentInfo depthAttachment{};
+				depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+				depthAttachment.imageView = graph.getImageView(sceneDepth);
+				depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+				depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+				VkRenderingInfo renderingInfo{};
+				renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+				renderingInfo.renderArea.offset = { 0, 0 };
+				renderingInfo.renderArea.extent = renderExtent;
+				renderingInfo.layerCount = 1;
+				renderingInfo.colorAttachmentCount = 0;
+				renderingInfo.pDepthAttachment = &depthAttachment;
+
+				vkCmdBeginRendering(commandBuffer, &renderingInfo);
+				drawScene(commandBuffer, getDepthPipeline());
+				vkCmdEndRendering(commandBuffer);
+			});
+	}
+
+	// With the pre-pass depth is only tested against, otherwise the pass writes it itself
+	RenderGraphPass& scenePass = renderGraph.addPass("triangle")
+		.read(culledDrawCommand, RenderGraphAccess::IndirectCommandRead)
+		.read(visibleObjects, RenderGraphAccess::VertexAttributeRead)
+		.write(sceneColor, RenderGraphAccess::ColorAttachmentWrite);
+	if (depthPrepassEnabled) {
+		scenePass.read(sceneDepth, RenderGraphAccess::DepthAttachmentRead);
+	}
+	else {
+		scenePass.write(sceneDepth, RenderGraphAccess::DepthAttachmentWrite);
+	}
+	scenePass.setExecute([this](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+		VkRenderingAttachmentInfo colorAttachment{};
+		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		colorAttachment.imageView = graph.getImageView(sceneColor);
+		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+		VkRenderingAttachmentInfo depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.imageView = graph.getImageView(sceneDepth);
+		if (depthPrepassEnabled) {
+			depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+		else {
+			depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+		}
+		// The pyramid build reads depth after this pass
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+		VkRenderingInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = renderExtent;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachments = &colorAttachment;
+		renderingInfo.pDepthAttachment = &depthAttachment;
+
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+		// Looked up every frame so a change to triangleVariant picks, or builds, the matching pipeline
+		drawScene(commandBuffer, getGraphicsPipeline());
+		vkCmdEndRendering(commandBuffer);
+	});
+
+	// The next frame culls against what this one drew, without occlusion the pyramid is never sampled
+	if (occlusionCullingEnabled) {
+		occlusionCuller.addBuildPass(renderGraph, sceneDepth);
+	}
+
+	postOutput = postProcess.addPasses(renderGraph, sceneColor, asyncComputeEnabled ? RenderGraphQueue::Compute : RenderGraphQueue::Graphics);
+
+	// Stretches the rendered part of the scene over the whole swap chain image
+	renderGraph.addPass("upscale")
+		.read(postOutput, RenderGraphAccess::TransferRead)
+		.write(backbuffer, RenderGraphAccess::TransferWrite)
+		.setExecute([this](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+			VkImageBlit region{};
+			region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.srcSubresource.mipLevel = 0;
+			region.srcSubresource.baseArrayLayer = 0;
+			region.srcSubresource.layerCount = 1;
+			region.srcOffsets[0] = { 0, 0, 0 };
+			region.srcOffsets[1] = { static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1 };
+			region.dstSubresource = region.srcSubresource;
+			region.dstOffsets[0] = { 0, 0, 0 };
+			region.dstOffsets[1] = { static_cast<int32_t>(swapChainExtent.width), static_cast<int32_t>(swapChainExtent.height), 1 };
+
+			vkCmdBlitImage(commandBuffer,
+				graph.getImage(postOutput), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				graph.getImage(backbuffer), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &region, upscaleFilter);
+		});
+
+	// Drawn after the upscale so the text stays sharp at any render scale, and before the capture so it is recorded with the frame
+	performanceHud.addPass(renderGraph, backbuffer);
+
+	if (captureEnabled) {
+		// Nothing in the frame reads the copy, so the pass has to be marked as having side effects or it would be culled
+		renderGraph.addPass("capture")
+			.read(backbuffer, RenderGraphAccess::TransferRead)
+			.setSideEffect(true)
+			.setExecute([this](VkCommandBuffer commandBuffer, const RenderGraph& graph) {
+				frameCapture.recordCopy(commandBuffer, graph.getImage(backbuffer), recordingPoint);
+			});
+	}
+
+	std::vector<uint32_t> graphQueueFamilies = { queueFamilies.graphicsFamily.value() };
+	if (asyncComputeEnabled) {
+		graphQueueFamilies.push_back(queueFamilies.computeFamily.value());
+	}
+	renderGraph.setQueueFamilies(graphQueueFamilies);
+	renderGraph.setTimer(&gpuTimer);
+
+	renderGraph.compile(device, physicalDevice, hostAllocator.getCallbacks());
+	renderGraph.printReport();
+
+	postProcess.writeDescriptorSets(renderGraph);
+	occlusionCuller.writeDescriptorSets(renderGraph, frameAllocator.getBuffer());
+}
+
+void VulkanApplication::drawScene(VkCommandBuffer commandBuffer, VkPipeline pipeline)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+	// Viewport and scissor were marked as dynamic states, so they have to be set before drawing
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(renderExtent.width);
+	viewport.height = static_cast<float>(renderExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = renderExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	// The culling pass wrote the visible objects and their count, the CPU never knows how many are drawn
+	const CulledDraw& draw = occlusionCuller.getDraw();
+	std::array<VkBuffer, 2> vertexBuffers = { vertexData.buffer, draw.visibleObjects.buffer };
+	std::array<VkDeviceSize, 2> vertexOffsets = { vertexData.offset, draw.visibleObjects.offset };
+	vkCmdBindVertexBuffers(commandBuffer, 0, static_cast<uint32_t>(vertexBuffers.size()), vertexBuffers.data(), vertexOffsets.data());
+
+	vkCmdDrawIndirect(commandBuffer, draw.drawCommand.buffer, draw.drawCommand.offset, 1, sizeof(VkDrawIndirectCommand));
 }
@@ -3,20 +3,81 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <map>
+#include <chrono>
 
 #define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
 #include <GLFW/glfw3.h>
 #include "QueueFamilyIndices.hpp"
 #include "SwapChainSupportDetails.hpp"
+#include "RenderGraph.hpp"
+#include "FrameAllocator.hpp"
+#include "Vertex.hpp"
+#include "PipelineVariantCache.hpp"
+#include "ThreadPool.hpp"
+#include "TaskGraph.hpp"
+#include "FrameCapture.hpp"
+#include "GpuTimer.hpp"
+#include "DynamicResolution.hpp"
+#include "PostProcessChain.hpp"
+#include "SubmissionScheduler.hpp"
+#include "OcclusionCuller.hpp"
+#include "ObjectInstance.hpp"
+#include "HostAllocator.hpp"
+#include "TransformSystem.hpp"
+#include "PerformanceHud.hpp"
 
 class VulkanApplication
 {
 public:
 	void run();
 
+	// Writes every presented frame to outputPath, must be called before run()
+	void enableCapture(const std::string& outputPath, FrameCapture::OutputFormat outputFormat);
+	// Renders frameCount frames into an offscreen image without creating a window or surface, then exits, must be called before run()
+	void enableHeadless(uint32_t frameCount);
+	// GPU time in milliseconds the dynamic resolution aims to keep a frame within, must be called before run()
+	void setGpuFrameBudget(double milliseconds);
+	// Runs post processing on the graphics queue even if there is a dedicated compute queue, for comparison
+	void disableAsyncCompute();
+	// Draws the scene without laying down depth first, for comparison
+	void disableDepthPrepass();
+	// Only culls objects outside of the view, for comparison
+	void disableOcclusionCulling();
+	// Leaves host memory to the driver's own allocator, for comparison
+	void disableHostAllocator();
+	// Starts with the performance HUD shown instead of waiting for F1
+	void showHud();
+
 private:
+	/* STARTUP */
+	// Initialization runs as a graph of tasks so that independent work such as file I/O, device queries and window creation overlap
+	ThreadPool threadPool;
+	TaskGraph startupTimeline;
+	bool firstFramePresented = false;
+	void init();
+
 	void mainLoop();
 	void cleanup();
+	void drawFrame();
+
+	/* MAIN LOOP */
+	// Frames are only rendered while something on screen can change, otherwise the loop blocks on window events
+	// Anything that changes the image calls requestRedraw(), frame capture and the performance HUD render continuously
+	static constexpr double UNFOCUSED_FRAME_INTERVAL = 1.0 / 30.0; // Frame rate cap in seconds while the window isn't focused
+	uint32_t pendingRedraws = 0;
+	bool windowFocused = true;
+	bool windowIconified = false;
+	double lastFrameTime = 0.0;
+	void runHeadless();
+	void requestRedraw();
+	bool isWindowVisible();
+
+	static void windowRefreshCallback(GLFWwindow *window);
+	static void windowFocusCallback(GLFWwindow *window, int focused);
+	static void windowIconifyCallback(GLFWwindow *window, int iconified);
+	static void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+	static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
 	/** GLFW **/
 	const uint32_t WIDTH = 800;
@@ -24,28 +85,115 @@ private:
 	GLFWwindow *window;
 
 	void initGLFW();
+	void createWindow();
 	void cleanupGLFW();
 
+	/* HEADLESS */
+	// Without a window the frame is rendered into an image owned by the application instead of a swap chain image
+	// It stands in as the only "swap chain image", so everything after the swap chain is created works unchanged
+	static const VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_SRGB; // Same encoding the swap chain prefers, so captures look the same
+	bool headless = false;
+	uint32_t headlessFrameCount = 0;
+	VkImage offscreenImage = VK_NULL_HANDLE;
+	VkDeviceMemory offscreenImageMemory = VK_NULL_HANDLE;
+	void createOffscreenTarget();
+
 	/** VULKAN **/
-	const std::vector<const char *> deviceExtensions = {
+	// Not const, the swap chain extension is dropped when running headless
+	std::vector<const char *> deviceExtensions = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
 	const std::vector<const char *> validationLayers = {
 		"VK_LAYER_KHRONOS_validation" // All useful standard validation bundled into this layer
 	};
 
+	HostAllocator hostAllocator; // Passed to every vkCreate* and vkDestroy* of this class and its helpers, reports host memory per scope at exit
 	VkInstance instance;
 	VkDebugUtilsMessengerEXT debugMessenger;
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device; // Logical device, interfaces to physical device
+	QueueFamilyIndices queueFamilies; // Of the picked physical device, queried once so later setup doesn't touch the surface concurrently
 	VkQueue graphicsQueue;
 	VkSurfaceKHR surface;
 	VkQueue presentQueue;
+	VkQueue computeQueue;
+	bool asyncComputeAllowed = true;
+	bool asyncComputeEnabled = false; // A dedicated compute queue was found and is used for post processing
 	VkSwapchainKHR swapChain;
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
+	VkSurfaceFormatKHR surfaceFormat; // Chosen together with the physical device, so pipelines can be built before the swap chain exists
+	VkPipelineLayout pipelineLayout;
+	VkShaderModule vertShaderModule;
+	VkShaderModule fragShaderModule;
+	VkCommandPool commandPool;
+	VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+
+	// How many frames the CPU is allowed to record ahead while the GPU is still working on previous ones
+	static const int MAX_FRAMES_IN_FLIGHT = 2;
+	uint32_t currentFrame = 0;
+	// Per frame in flight, one for each of the render graph's submissions
+	std::vector<std::vector<VkCommandBuffer>> commandBuffers;
+	std::vector<VkSemaphore> imageAvailableSemaphores;
+	std::vector<VkSemaphore> renderFinishedSemaphores; // One per swap chain image, as presentation may still be using it
+
+	/* SUBMISSION */
+	// Every queue submission goes through the scheduler, a frame in flight is done once its point on the timeline is reached
+	SubmissionScheduler scheduler;
+	uint32_t graphicsQueueId = 0;
+	uint32_t computeQueueId = 0;
+	std::vector<TimelinePoint> framePoints;
+	TimelinePoint recordingPoint; // Signaled by the submission that is currently being recorded
+
+	RenderGraph renderGraph;
+	RenderGraphResource backbuffer;
+	RenderGraphResource sceneColor;
+	RenderGraphResource postOutput;
+
+	/* POST PROCESSING */
+	PostProcessShaders postShaderCode;
+	PostProcessChain postProcess;
+	void createPostProcessChain();
+
+	/* OCCLUSION CULLING */
+	// Objects are tested against the previous frame's depth pyramid and only the visible ones are drawn, see OcclusionCuller
+	// With the pre-pass depth is laid down first, so the color pass only shades the closest surface of each pixel
+	OcclusionCullerShaders occlusionShaderCode;
+	OcclusionCuller occlusionCuller;
+	RenderGraphResource sceneDepth;
+	RenderGraphResource hiZPyramid;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	bool depthPrepassEnabled = true;
+	bool occlusionCullingEnabled = true;
+	TransformSystem transforms; // One per object, written into the objects to cull every frame
+	glm::vec4 meshBounds; // Minimum and maximum position of vertices, what the culling tests are based on
+	void createScene();
+	void createOcclusionCuller();
+	void initializeGpuResources();
+	VkFormat findDepthFormat();
+
+	/* PERFORMANCE HUD */
+	// Frame times, GPU pass timings, memory and culling counts drawn over the swap chain image, toggled with F1
+	PerformanceHudShaders hudShaderCode;
+	PerformanceHud performanceHud;
+	bool hudVisible = false;
+	std::chrono::steady_clock::time_point lastDrawTime; // When the previous drawFrame() started, GLFW's timer isn't available headless
+	void createPerformanceHud();
+	PerformanceHudStats gatherHudStats(double frameMilliseconds);
+
+	// Per-frame uniforms, dynamic vertices and indirect arguments are sub-allocated from here
+	static const VkDeviceSize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024;
+	FrameAllocator frameAllocator;
+	bool bufferDeviceAddressEnabled = false;
+
+	const std::vector<Vertex> vertices = {
+		{{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+		{{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+		{{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+	};
+	FrameAllocation vertexData; // This frame's copy of vertices, shared by every pass that draws the scene
 
 	// Determines what variables are changeable during drawing time
 	std::vector<VkDynamicState> dynamicStates = {
@@ -59,7 +207,6 @@ private:
 	const bool enableValidationLayers = true;
 #endif
 
-	void initVulkan();
 	void cleanupVulkan();
 	void createInstance();
 
@@ -90,8 +237,12 @@ private:
 	void createSurface();
 
 	/* PHYSICAL DEVICE */
+	// Split in two, everything that doesn't need the surface runs while the window is still being created
+	std::multimap<int, VkPhysicalDevice> deviceCandidates;
+	void enumeratePhysicalDevices();
 	void pickPhysicalDevice();
 	int rateDeviceSuitability(VkPhysicalDevice device);
+	bool isDeviceSurfaceCompatible(VkPhysicalDevice device);
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 
@@ -112,7 +263,68 @@ private:
 
 	/* GRAPHICS PIPELINE */
 	void createGraphicsPipeline();
+	VkPipeline buildGraphicsPipeline(const VkSpecializationInfo *specializationInfo, VkPipelineCache pipelineCache, bool depthOnly);
+	VkPipeline getGraphicsPipeline();
+	VkPipeline getDepthPipeline(); // Vertex stage only, for the depth pre-pass
+
+	/* SHADER VARIANTS */
+	// Specialization constants declared in shaders/shader.frag, see constant_id
+	// F2 toggles grayscale, F3 invert and F4 steps through the contrast iterations, each combination is its own pipeline
+	// The scene shader samples no textures, so unlike feature bits and loop counts a sample count constant would have nothing to control
+	enum TriangleShaderConstant : uint32_t {
+		TRIANGLE_FEATURE_BITS = 0,
+		TRIANGLE_CONTRAST_ITERATIONS = 1
+	};
+	enum TriangleShaderFeature : uint32_t {
+		TRIANGLE_FEATURE_GRAYSCALE = 1 << 0,
+		TRIANGLE_FEATURE_INVERT = 1 << 1
+	};
+	static const uint32_t MAX_CONTRAST_ITERATIONS = 3;
+
+	const std::string pipelineCacheFile = "pipeline_cache.bin";
+	std::vector<char> vertShaderCode;
+	std::vector<char> fragShaderCode;
+	std::vector<char> pipelineCacheData;
+	void loadShaderCode();
+	void loadPipelineCache();
+	PipelineVariantCache pipelineVariants;
+	ShaderVariantKey triangleVariant;
+	void toggleTriangleFeature(TriangleShaderFeature feature);
+	void cycleContrastIterations();
+	void printTriangleVariant();
 	VkShaderModule createShaderModule(const std::vector<char>& code);
 
-	static std::vector<char> readFile(const std::string& filename);
+	/* COMMAND BUFFERS */
+	void createCommandPool();
+	void createCommandBuffers();
+	void createSyncObjects();
+
+	/* FRAME ALLOCATOR */
+	void createFrameAllocator();
+
+	/* FRAME CAPTURE */
+	// Readback buffers in flight on top of the frames in flight, gives the worker threads a few frames to write each one out
+	static const uint32_t CAPTURE_RING_SIZE = MAX_FRAMES_IN_FLIGHT + 3;
+	bool captureEnabled = false;
+	std::string captureOutputPath;
+	FrameCapture::OutputFormat captureOutputFormat = FrameCapture::OutputFormat::PpmSequence;
+	FrameCapture frameCapture;
+	void createFrameCapture();
+
+	/* DYNAMIC RESOLUTION */
+	// The scene is rendered into a target allocated at the largest scale, only the top left renderExtent of it is used
+	// and then upscaled onto the swap chain image, so changing the scale never recreates anything
+	static const uint32_t MAX_GPU_TIMER_SCOPES = 32;
+	GpuTimer gpuTimer;
+	DynamicResolution dynamicResolution;
+	VkExtent2D renderExtent;
+	VkFilter upscaleFilter = VK_FILTER_LINEAR;
+	void createGpuTimer();
+	void updateRenderScale();
+
+	/* RENDER GRAPH */
+	// Describes the passes of a frame, the graph takes care of barriers and layout transitions in between them
+	void buildRenderGraph();
+	// Draws the objects that survived culling with one indirect draw, inside a pass that already began rendering
+	void drawScene(VkCommandBuffer commandBuffer, VkPipeline pipeline);
 };
\ No newline at end of file
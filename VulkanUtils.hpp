@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+// Graphic cards offer different types of memory, each varying in allowed operations and performance
+// typeFilter is a bit field of the memory types that are suitable, usually taken from VkMemoryRequirements
+// Returns the index of the first memory type that is suitable and has all the requested properties
+inline uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+// Rounds value up to the next multiple of alignment, alignment has to be a power of two
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Reads a whole file into memory, used for SPIR-V and the pipeline cache
+inline std::vector<char> readFile(const std::string &filename)
+{
+	// std;:ios::ate, start reading at the end of the file
+	// std::ios::binary, read the file as binary
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	file.close();
+
+	return buffer;
+}
+
+inline void writeFile(const std::string &filename, const std::vector<char> &data)
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file for writing!");
+	}
+
+	file.write(data.data(), data.size());
+	file.close();
+}
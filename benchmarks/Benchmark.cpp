@@ -0,0 +1,262 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// CPU time of every thread of the process, drivers may do part of the work on their own threads
+static double processCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+
+	// FILETIME counts in 100 nanosecond intervals
+	auto toSeconds = [](const FILETIME &time) {
+		return static_cast<double>((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+	};
+	return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+	timespec time;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+	return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+#endif
+}
+
+static std::string escapeJson(const std::string &text)
+{
+	std::string escaped;
+	for (char c : text) {
+		switch (c) {
+		case '"': escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\n': escaped += "\\n"; break;
+		case '\t': escaped += "\\t"; break;
+		default: escaped += c; break;
+		}
+	}
+	return escaped;
+}
+
+bool BenchmarkState::keepRunning()
+{
+	if (!started) {
+		started = true;
+		startTimer();
+	}
+
+	if (iterations < maxIterations) {
+		++iterations;
+		return true;
+	}
+
+	if (!paused) {
+		stopTimer();
+	}
+	return false;
+}
+
+void BenchmarkState::pauseTiming()
+{
+	if (!paused) {
+		stopTimer();
+		paused = true;
+	}
+}
+
+void BenchmarkState::resumeTiming()
+{
+	if (paused) {
+		paused = false;
+		startTimer();
+	}
+}
+
+void BenchmarkState::startTimer()
+{
+	realStart = Clock::now();
+	cpuStart = processCpuSeconds();
+}
+
+void BenchmarkState::stopTimer()
+{
+	realSeconds += std::chrono::duration<double>(Clock::now() - realStart).count();
+	cpuSeconds += processCpuSeconds() - cpuStart;
+}
+
+void BenchmarkRunner::add(const std::string &name, Function function)
+{
+	benchmarks.push_back({ name, std::move(function) });
+}
+
+bool BenchmarkRunner::run(const BenchmarkOptions &options)
+{
+	results.clear();
+	bool succeeded = true;
+
+	std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(16) << "Time" << std::setw(16) << "CPU"
+		<< std::setw(14) << "Iterations" << std::endl;
+	std::cout << std::string(86, '-') << std::endl;
+
+	for (const Benchmark &benchmark : benchmarks) {
+		if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+			continue;
+		}
+
+		BenchmarkResult result = runBenchmark(benchmark, options);
+		succeeded = succeeded && result.error.empty();
+
+		printResult(result);
+		results.push_back(std::move(result));
+	}
+
+	if (!options.jsonPath.empty()) {
+		writeJson(options.jsonPath);
+	}
+
+	return succeeded;
+}
+
+BenchmarkResult BenchmarkRunner::runBenchmark(const Benchmark &benchmark, const BenchmarkOptions &options)
+{
+	BenchmarkResult result;
+	result.name = benchmark.name;
+
+	uint64_t iterations = 1;
+
+	try {
+		while (true) {
+			BenchmarkState state(iterations);
+			benchmark.function(state);
+
+			if (state.iterations != iterations) {
+				throw std::runtime_error("benchmark didn't run its loop until keepRunning() returned false!");
+			}
+
+			// Grow by the factor that should reach minTime, with some headroom, but never more than 10x at a time
+			bool done = state.realSeconds >= options.minTime || iterations >= options.maxIterations;
+			if (!done) {
+				double factor = state.realSeconds > 0.0 ? options.minTime / state.realSeconds * 1.4 : 10.0;
+				factor = std::clamp(factor, 2.0, 10.0);
+				iterations = std::min(static_cast<uint64_t>(static_cast<double>(iterations) * factor), options.maxIterations);
+				continue;
+			}
+
+			result.iterations = iterations;
+			result.realTime = state.realSeconds * 1e9 / static_cast<double>(iterations);
+			result.cpuTime = state.cpuSeconds * 1e9 / static_cast<double>(iterations);
+			if (state.realSeconds > 0.0) {
+				result.bytesPerSecond = static_cast<double>(state.bytesProcessed) / state.realSeconds;
+				result.itemsPerSecond = static_cast<double>(state.itemsProcessed) / state.realSeconds;
+			}
+			result.counters = state.counters;
+			break;
+		}
+	}
+	catch (const std::exception &e) {
+		result.error = e.what();
+	}
+
+	return result;
+}
+
+void BenchmarkRunner::printResult(const BenchmarkResult &result) const
+{
+	// Formatted on its own stream so the precision doesn't stick to std::cout
+	std::ostringstream line;
+	line << std::left << std::setw(40) << result.name << std::right;
+
+	if (!result.error.empty()) {
+		std::cout << line.str() << " ERROR: " << result.error << std::endl;
+		return;
+	}
+
+	line << std::fixed << std::setprecision(0)
+		<< std::setw(13) << result.realTime << " ns" << std::setw(13) << result.cpuTime << " ns" << std::setw(14) << result.iterations;
+
+	if (result.bytesPerSecond > 0.0) {
+		line << std::setprecision(1) << "  " << result.bytesPerSecond / (1024.0 * 1024.0) << " MiB/s";
+	}
+	if (result.itemsPerSecond > 0.0) {
+		line << std::setprecision(0) << "  " << result.itemsPerSecond << " items/s";
+	}
+	for (const auto &counter : result.counters) {
+		line << std::setprecision(2) << "  " << counter.first << "=" << counter.second;
+	}
+
+	std::cout << line.str() << std::endl;
+}
+
+void BenchmarkRunner::writeJson(const std::string &path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open benchmark output file!");
+	}
+
+	std::time_t now = std::time(nullptr);
+	char date[32];
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	file << std::setprecision(17);
+	file << "{\n  \"context\": {\n";
+	file << "    \"date\": \"" << date << "\",\n";
+	file << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+	file << "    \"library_build_type\": \"release\"";
+#else
+	file << "    \"library_build_type\": \"debug\"";
+#endif
+	for (const auto &entry : context) {
+		file << ",\n    \"" << escapeJson(entry.first) << "\": \"" << escapeJson(entry.second) << "\"";
+	}
+	file << "\n  },\n  \"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchmarkResult &result = results[i];
+
+		file << (i > 0 ? ",\n" : "\n") << "    {\n";
+		file << "      \"name\": \"" << escapeJson(result.name) << "\",\n";
+		file << "      \"run_name\": \"" << escapeJson(result.name) << "\",\n";
+		file << "      \"run_type\": \"iteration\",\n";
+		file << "      \"repetitions\": 1,\n";
+		file << "      \"repetition_index\": 0,\n";
+		file << "      \"threads\": 1,\n";
+
+		// Failed benchmarks are still listed so a regression gate notices them missing
+		if (!result.error.empty()) {
+			file << "      \"error_occurred\": true,\n";
+			file << "      \"error_message\": \"" << escapeJson(result.error) << "\"\n    }";
+			continue;
+		}
+
+		file << "      \"iterations\": " << result.iterations << ",\n";
+		file << "      \"real_time\": " << result.realTime << ",\n";
+		file << "      \"cpu_time\": " << result.cpuTime << ",\n";
+		file << "      \"time_unit\": \"ns\"";
+		if (result.bytesPerSecond > 0.0) {
+			file << ",\n      \"bytes_per_second\": " << result.bytesPerSecond;
+		}
+		if (result.itemsPerSecond > 0.0) {
+			file << ",\n      \"items_per_second\": " << result.itemsPerSecond;
+		}
+		for (const auto &counter : result.counters) {
+			file << ",\n      \"" << escapeJson(counter.first) << "\": " << counter.second;
+		}
+		file << "\n    }";
+	}
+
+	file << "\n  ]\n}\n";
+}
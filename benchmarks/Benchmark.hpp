@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Passed to every benchmark, the code to measure runs in a loop on keepRunning()
+// while (state.keepRunning()) { ... }
+class BenchmarkState
+{
+public:
+	explicit BenchmarkState(uint64_t maxIterations) : maxIterations(maxIterations) {}
+
+	// Starts the clock on the first call and stops it once maxIterations have run
+	bool keepRunning();
+
+	// Setup and teardown inside the loop that shouldn't count towards the measured time
+	void pauseTiming();
+	void resumeTiming();
+
+	// Reported per second of measured time
+	void setBytesProcessed(uint64_t bytes) { bytesProcessed = bytes; }
+	void setItemsProcessed(uint64_t items) { itemsProcessed = items; }
+	// Reported as is
+	void setCounter(const std::string &name, double value) { counters[name] = value; }
+
+	uint64_t getIterations() const { return iterations; }
+
+private:
+	friend class BenchmarkRunner;
+	using Clock = std::chrono::steady_clock;
+
+	uint64_t maxIterations = 0;
+	uint64_t iterations = 0;
+	bool started = false;
+	bool paused = false;
+
+	Clock::time_point realStart;
+	double cpuStart = 0.0;
+	double realSeconds = 0.0;
+	double cpuSeconds = 0.0;
+
+	uint64_t bytesProcessed = 0;
+	uint64_t itemsProcessed = 0;
+	std::map<std::string, double> counters;
+
+	void startTimer();
+	void stopTimer();
+};
+
+struct BenchmarkResult {
+	std::string name;
+	uint64_t iterations = 0;
+	double realTime = 0.0; // Nanoseconds per iteration
+	double cpuTime = 0.0; // Nanoseconds per iteration, of the whole process so driver threads are included
+	double bytesPerSecond = 0.0;
+	double itemsPerSecond = 0.0;
+	std::map<std::string, double> counters;
+	std::string error; // Set if the benchmark threw, the result is reported but not timed
+};
+
+struct BenchmarkOptions {
+	double minTime = 0.5; // Seconds every benchmark runs for at least, iterations are scaled up until it does
+	uint64_t maxIterations = 1000000000;
+	std::string filter; // Only benchmarks whose name contains it are run
+	std::string jsonPath; // Empty to only print to stdout
+};
+
+/*
+* Minimal benchmark runner, modeled after Google Benchmark so its tooling can be used on the results
+* - Every benchmark is run with a growing iteration count until it takes at least minTime, only the last run is reported
+* - Results are printed as a table and optionally written as JSON in the same format as --benchmark_format=json
+*   which tools/compare.py of Google Benchmark can diff between two runs
+*/
+class BenchmarkRunner
+{
+public:
+	using Function = std::function<void(BenchmarkState &state)>;
+
+	void add(const std::string &name, Function function);
+	// Recorded in the JSON context, e.g. which device and driver the numbers came from
+	void setContext(const std::string &key, const std::string &value) { context[key] = value; }
+
+	// Returns false if any benchmark failed
+	bool run(const BenchmarkOptions &options);
+
+private:
+	struct Benchmark {
+		std::string name;
+		Function function;
+	};
+
+	std::vector<Benchmark> benchmarks;
+	std::map<std::string, std::string> context;
+	std::vector<BenchmarkResult> results;
+
+	BenchmarkResult runBenchmark(const Benchmark &benchmark, const BenchmarkOptions &options);
+	void printResult(const BenchmarkResult &result) const;
+	void writeJson(const std::string &path) const;
+};
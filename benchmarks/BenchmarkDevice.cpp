@@ -0,0 +1,172 @@
+#include "BenchmarkDevice.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+void BenchmarkDevice::create(const std::string &deviceName)
+{
+	instance = createInstance();
+
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+	for (VkPhysicalDevice candidate : devices) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(candidate, &properties);
+
+		uint32_t graphicsFamily = 0;
+		if (!isDeviceSuitable(candidate, graphicsFamily)) {
+			continue;
+		}
+		if (!deviceName.empty() && std::string(properties.deviceName).find(deviceName) == std::string::npos) {
+			continue;
+		}
+
+		physicalDevice = candidate;
+		queueFamily = graphicsFamily;
+		break;
+	}
+
+	if (physicalDevice == VK_NULL_HANDLE) {
+		throw std::runtime_error("failed to find a suitable GPU to benchmark!");
+	}
+
+	device = createDevice();
+	vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create command pool!");
+	}
+}
+
+void BenchmarkDevice::destroy()
+{
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+}
+
+VkInstance BenchmarkDevice::createInstance()
+{
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Vulkan Benchmarks";
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName = "No Engine";
+	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion = VK_API_VERSION_1_3;
+
+	// No surface extensions and no validation layers, neither is part of what's measured
+	VkInstanceCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	createInfo.pApplicationInfo = &appInfo;
+
+	VkInstance createdInstance;
+	if (vkCreateInstance(&createInfo, nullptr, &createdInstance) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create vulkan instance!");
+	}
+
+	return createdInstance;
+}
+
+VkDevice BenchmarkDevice::createDevice() const
+{
+	float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo queueCreateInfo{};
+	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueCreateInfo.queueFamilyIndex = queueFamily;
+	queueCreateInfo.queueCount = 1;
+	queueCreateInfo.pQueuePriorities = &queuePriority;
+
+	// Same features VulkanApplication::createLogicalDevice enables, minus the optional ones
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.synchronization2 = VK_TRUE;
+	vulkan13Features.dynamicRendering = VK_TRUE;
+	vulkan13Features.pNext = &vulkan12Features;
+
+	VkDeviceCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &vulkan13Features;
+	createInfo.queueCreateInfoCount = 1;
+	createInfo.pQueueCreateInfos = &queueCreateInfo;
+
+	VkDevice createdDevice;
+	if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &createdDevice) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create logical device!");
+	}
+
+	return createdDevice;
+}
+
+bool BenchmarkDevice::isDeviceSuitable(VkPhysicalDevice candidate, uint32_t &graphicsFamily) const
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(candidate, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_3) {
+		return false;
+	}
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.pNext = &vulkan12Features;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &vulkan13Features;
+	vkGetPhysicalDeviceFeatures2(candidate, &features);
+
+	if (!vulkan13Features.synchronization2 || !vulkan13Features.dynamicRendering || !vulkan12Features.timelineSemaphore) {
+		return false;
+	}
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+
+	for (uint32_t i = 0; i < familyCount; ++i) {
+		if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+			graphicsFamily = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::string BenchmarkDevice::getDeviceDescription() const
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	return std::string(properties.deviceName) + " (Vulkan " + std::to_string(VK_API_VERSION_MAJOR(properties.apiVersion)) + "."
+		+ std::to_string(VK_API_VERSION_MINOR(properties.apiVersion)) + "." + std::to_string(VK_API_VERSION_PATCH(properties.apiVersion)) + ")";
+}
+
+std::string BenchmarkDevice::getDriverDescription() const
+{
+	VkPhysicalDeviceDriverProperties driverProperties{};
+	driverProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DRIVER_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &driverProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	return std::string(driverProperties.driverName) + " " + driverProperties.driverInfo;
+}
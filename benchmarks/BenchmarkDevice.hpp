@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#define GLFW_INCLUDE_VULKAN // Informs glfw to automatically include vulkan headers
+#include <GLFW/glfw3.h>
+
+/*
+* Headless Vulkan instance and device for the benchmarks, there is no window or surface
+* Created with the same API version and features as VulkanApplication so the measured driver paths match
+*
+* Runs on whatever ICD the loader finds, a software one such as lavapipe can be forced with
+* VK_DRIVER_FILES (VK_ICD_FILENAMES on older loaders) pointing at its ICD json, or picked by name with --device
+*/
+class BenchmarkDevice
+{
+public:
+	// deviceName is matched as a substring of the device name, empty picks the first suitable device
+	void create(const std::string &deviceName);
+	void destroy();
+
+	// Both are exposed separately as creating them is measured too, the caller owns the returned handle
+	static VkInstance createInstance();
+	VkDevice createDevice() const;
+
+	VkInstance getInstance() const { return instance; }
+	VkPhysicalDevice getPhysicalDevice() const { return physicalDevice; }
+	VkDevice getDevice() const { return device; }
+	VkQueue getQueue() const { return queue; }
+	uint32_t getQueueFamily() const { return queueFamily; }
+	VkCommandPool getCommandPool() const { return commandPool; }
+
+	// Device and driver name and version, recorded with the results
+	std::string getDeviceDescription() const;
+	std::string getDriverDescription() const;
+
+private:
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t queueFamily = 0;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+
+	bool isDeviceSuitable(VkPhysicalDevice candidate, uint32_t &graphicsFamily) const;
+};
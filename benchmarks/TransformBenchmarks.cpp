@@ -0,0 +1,84 @@
+#include "TransformBenchmarks.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TransformSystem.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+const uint32_t TRANSFORM_COUNT = 1024 * 1024;
+const uint32_t ROOT_COUNT = 256;
+const uint32_t CHILD_COUNT = 4; // Per transform, gives a hierarchy seven levels deep
+
+// Created breadth first, which is already sorted by level so the first update doesn't have to reorder anything
+std::unique_ptr<TransformSystem> createHierarchy()
+{
+	std::unique_ptr<TransformSystem> transforms = std::make_unique<TransformSystem>();
+	transforms->reserve(TRANSFORM_COUNT);
+
+	for (uint32_t i = 0; i < TRANSFORM_COUNT; ++i) {
+		TransformHandle parent = i < ROOT_COUNT ? TransformSystem::INVALID_TRANSFORM : (i - ROOT_COUNT) / CHILD_COUNT;
+		Transform local;
+		local.position = glm::vec2(static_cast<float>(i % 7) * 0.1f, static_cast<float>(i % 5) * 0.1f);
+		local.depth = 0.001f;
+		local.scale = 0.9f;
+		transforms->create(local, parent);
+	}
+
+	return transforms;
+}
+
+enum class DirtyPattern {
+	Everything, // Every root moves, so every transform is recomputed
+	OneSubtree, // A single root moves, 1 / ROOT_COUNT of the transforms are recomputed
+	Nothing // Only the copy into the instance buffer
+};
+
+void addUpdateBenchmark(BenchmarkRunner &runner, const std::string &name, DirtyPattern pattern, bool threaded)
+{
+	runner.add(name, [pattern, threaded](BenchmarkState &state) {
+		std::unique_ptr<TransformSystem> transforms = createHierarchy();
+		std::unique_ptr<ThreadPool> threadPool = threaded ? std::make_unique<ThreadPool>() : nullptr;
+
+		// Stands in for the mapped instance buffer VulkanApplication writes into
+		std::vector<ObjectInstance> instances(TRANSFORM_COUNT);
+		transforms->update(instances.data(), threadPool.get());
+
+		Transform root = transforms->getLocal(0);
+		uint64_t updated = 0;
+
+		while (state.keepRunning()) {
+			root.position.x = -root.position.x;
+
+			if (pattern == DirtyPattern::Everything) {
+				for (TransformHandle handle = 0; handle < ROOT_COUNT; ++handle) {
+					transforms->setLocal(handle, root);
+				}
+			}
+			else if (pattern == DirtyPattern::OneSubtree) {
+				transforms->setLocal(0, root);
+			}
+
+			transforms->update(instances.data(), threadPool.get());
+			updated += transforms->getUpdatedCount();
+		}
+
+		state.setItemsProcessed(state.getIterations() * TRANSFORM_COUNT);
+		state.setBytesProcessed(state.getIterations() * TRANSFORM_COUNT * sizeof(ObjectInstance));
+		state.setCounter("updated_per_frame", static_cast<double>(updated) / static_cast<double>(state.getIterations()));
+		state.setCounter("threads", threadPool ? threadPool->getThreadCount() + 1.0 : 1.0);
+	});
+}
+
+}
+
+void registerTransformBenchmarks(BenchmarkRunner &runner)
+{
+	addUpdateBenchmark(runner, "transform/update_all/1M", DirtyPattern::Everything, true);
+	addUpdateBenchmark(runner, "transform/update_all/1M/single_thread", DirtyPattern::Everything, false);
+	addUpdateBenchmark(runner, "transform/update_subtree/1M", DirtyPattern::OneSubtree, true);
+	addUpdateBenchmark(runner, "transform/update_none/1M", DirtyPattern::Nothing, true);
+}
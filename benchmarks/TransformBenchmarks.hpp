@@ -0,0 +1,6 @@
+#pragma once
+
+#include "Benchmark.hpp"
+
+// TransformSystem updating a million transforms per frame, CPU only so no device is involved
+void registerTransformBenchmarks(BenchmarkRunner &runner);
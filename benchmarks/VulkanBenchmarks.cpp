@@ -0,0 +1,584 @@
+#include "VulkanBenchmarks.hpp"
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "VulkanUtils.hpp"
+#include "Vertex.hpp"
+#include "ObjectInstance.hpp"
+#include "PipelineVariantCache.hpp"
+#include "SubmissionScheduler.hpp"
+
+namespace {
+
+// Sizes of what the application creates at startup, see VulkanApplication
+const VkExtent2D TARGET_EXTENT = { 800, 600 };
+const uint32_t SWAP_CHAIN_IMAGE_COUNT = 3;
+const VkFormat SWAP_CHAIN_FORMAT = VK_FORMAT_B8G8R8A8_SRGB;
+const VkFormat SCENE_COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT; // PostProcessChain::COLOR_FORMAT
+const VkFormat SCENE_DEPTH_FORMAT = VK_FORMAT_D16_UNORM; // The one depth format every device has to support
+
+const std::vector<Vertex> vertices = {
+	{{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+	{{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+	{{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+};
+
+struct Image {
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+};
+
+struct Buffer {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+};
+
+// Everything the benchmarks share, created once up front so only the measured calls run inside the loops
+struct SharedResources {
+	BenchmarkDevice *device = nullptr;
+	std::vector<std::string> shaderFiles;
+	std::vector<char> vertShaderCode;
+	std::vector<char> fragShaderCode;
+	VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	std::vector<char> warmCacheData; // Cache data after the triangle pipeline was built once
+
+	~SharedResources() {
+		VkDevice vkDevice = device->getDevice();
+		vkDestroyPipelineLayout(vkDevice, pipelineLayout, nullptr);
+		vkDestroyShaderModule(vkDevice, fragShaderModule, nullptr);
+		vkDestroyShaderModule(vkDevice, vertShaderModule, nullptr);
+	}
+};
+
+Image createImage(const BenchmarkDevice &device, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectMask)
+{
+	VkDevice vkDevice = device.getDevice();
+	Image image;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { TARGET_EXTENT.width, TARGET_EXTENT.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(vkDevice, &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create image!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(vkDevice, image.image, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(device.getPhysicalDevice(), memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(vkDevice, &allocInfo, nullptr, &image.memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate image memory!");
+	}
+
+	vkBindImageMemory(vkDevice, image.image, image.memory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = aspectMask;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(vkDevice, &viewInfo, nullptr, &image.view) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create image view!");
+	}
+
+	return image;
+}
+
+void destroyImage(const BenchmarkDevice &device, const Image &image)
+{
+	vkDestroyImageView(device.getDevice(), image.view, nullptr);
+	vkDestroyImage(device.getDevice(), image.image, nullptr);
+	vkFreeMemory(device.getDevice(), image.memory, nullptr);
+}
+
+// Host visible and coherent, filled once with data
+Buffer createVertexBuffer(const BenchmarkDevice &device, const void *data, VkDeviceSize size)
+{
+	VkDevice vkDevice = device.getDevice();
+	Buffer buffer;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(vkDevice, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create vertex buffer!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(vkDevice, buffer.buffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(device.getPhysicalDevice(), memoryRequirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (vkAllocateMemory(vkDevice, &allocInfo, nullptr, &buffer.memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate vertex buffer memory!");
+	}
+
+	vkBindBufferMemory(vkDevice, buffer.buffer, buffer.memory, 0);
+
+	void *mapped;
+	vkMapMemory(vkDevice, buffer.memory, 0, size, 0, &mapped);
+	std::memcpy(mapped, data, static_cast<size_t>(size));
+	vkUnmapMemory(vkDevice, buffer.memory);
+
+	return buffer;
+}
+
+void destroyBuffer(const BenchmarkDevice &device, const Buffer &buffer)
+{
+	vkDestroyBuffer(device.getDevice(), buffer.buffer, nullptr);
+	vkFreeMemory(device.getDevice(), buffer.memory, nullptr);
+}
+
+VkCommandBuffer allocateCommandBuffer(const BenchmarkDevice &device)
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = device.getCommandPool();
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate command buffers!");
+	}
+
+	return commandBuffer;
+}
+
+VkShaderModule createShaderModule(VkDevice device, const std::vector<char> &code)
+{
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	return shaderModule;
+}
+
+// Same state as VulkanApplication::buildGraphicsPipeline builds for the color pass without a depth pre-pass
+VkPipeline buildTrianglePipeline(const SharedResources &resources, const VkSpecializationInfo *specializationInfo, VkPipelineCache pipelineCache)
+{
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = resources.vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = resources.fragShaderModule;
+	shaderStages[1].pName = "main";
+	shaderStages[1].pSpecializationInfo = specializationInfo;
+
+	std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = { Vertex::getBindingDescription(), ObjectInstance::getBindingDescription() };
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	for (const auto &attribute : Vertex::getAttributeDescriptions()) {
+		attributeDescriptions.push_back(attribute);
+	}
+	for (const auto &attribute : ObjectInstance::getAttributeDescriptions()) {
+		attributeDescriptions.push_back(attribute);
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.minSampleShading = 1.0f;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &SCENE_COLOR_FORMAT;
+	renderingInfo.depthAttachmentFormat = SCENE_DEPTH_FORMAT;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &renderingInfo;
+	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = resources.pipelineLayout;
+
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(resources.device->getDevice(), pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+
+	return pipeline;
+}
+
+// Goes through PipelineVariantCache like the application does, initialData empty for a cold cache
+void buildThroughVariantCache(const SharedResources &resources, const std::vector<char> &initialData, std::vector<char> *cacheData)
+{
+	PipelineVariantCache cache;
+	cache.create(resources.device->getDevice(), resources.device->getPhysicalDevice(), initialData);
+
+	cache.get("triangle", ShaderVariantKey{}, [&resources](const ShaderVariantKey &key, const VkSpecializationInfo *specializationInfo, VkPipelineCache pipelineCache) {
+		return buildTrianglePipeline(resources, specializationInfo, pipelineCache);
+	});
+
+	if (cacheData != nullptr) {
+		*cacheData = cache.getCacheData();
+	}
+	cache.destroy();
+}
+
+void recordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspectMask, VkImageLayout newLayout,
+	VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask)
+{
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	barrier.srcAccessMask = VK_ACCESS_2_NONE;
+	barrier.dstStageMask = dstStageMask;
+	barrier.dstAccessMask = dstAccessMask;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { aspectMask, 0, 1, 0, 1 };
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+}
+
+void registerVulkanBenchmarks(BenchmarkRunner &runner, BenchmarkDevice &device, const std::string &shaderDirectory)
+{
+	auto resources = std::make_shared<SharedResources>();
+	resources->device = &device;
+	VkDevice vkDevice = device.getDevice();
+
+	// Every SPIR-V file VulkanApplication::loadShaderCode reads at startup
+	for (const char *name : { "vert.spv", "frag.spv", "luminance_histogram.spv", "exposure.spv", "exposure_subgroup.spv", "bloom_downsample.spv",
+		"bloom_upsample.spv", "tonemap.spv", "hiz_build.spv", "occlusion_cull.spv" }) {
+		resources->shaderFiles.push_back(shaderDirectory + "/" + name);
+	}
+
+	resources->vertShaderCode = readFile(shaderDirectory + "/vert.spv");
+	resources->fragShaderCode = readFile(shaderDirectory + "/frag.spv");
+	resources->vertShaderModule = createShaderModule(vkDevice, resources->vertShaderCode);
+	resources->fragShaderModule = createShaderModule(vkDevice, resources->fragShaderCode);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+	if (vkCreatePipelineLayout(vkDevice, &pipelineLayoutInfo, nullptr, &resources->pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	buildThroughVariantCache(*resources, {}, &resources->warmCacheData);
+
+	/* SETUP */
+	runner.add("setup/create_instance", [](BenchmarkState &state) {
+		while (state.keepRunning()) {
+			vkDestroyInstance(BenchmarkDevice::createInstance(), nullptr);
+		}
+	});
+
+	runner.add("setup/create_device", [&device](BenchmarkState &state) {
+		while (state.keepRunning()) {
+			vkDestroyDevice(device.createDevice(), nullptr);
+		}
+	});
+
+	// createSwapChain and createImageViews without a surface, the images are allocated by us instead of the presentation engine
+	runner.add("setup/offscreen_swap_chain", [&device](BenchmarkState &state) {
+		std::vector<Image> images(SWAP_CHAIN_IMAGE_COUNT);
+
+		while (state.keepRunning()) {
+			for (Image &image : images) {
+				image = createImage(device, SWAP_CHAIN_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+			}
+			for (const Image &image : images) {
+				destroyImage(device, image);
+			}
+		}
+
+		state.setItemsProcessed(state.getIterations() * SWAP_CHAIN_IMAGE_COUNT);
+	});
+
+	/* SHADERS */
+	runner.add("shader/read_file", [resources](BenchmarkState &state) {
+		uint64_t bytes = 0;
+
+		while (state.keepRunning()) {
+			for (const std::string &file : resources->shaderFiles) {
+				bytes += readFile(file).size();
+			}
+		}
+
+		state.setBytesProcessed(bytes);
+	});
+
+	runner.add("shader/create_module", [resources](BenchmarkState &state) {
+		VkDevice vkDevice = resources->device->getDevice();
+
+		while (state.keepRunning()) {
+			vkDestroyShaderModule(vkDevice, createShaderModule(vkDevice, resources->vertShaderCode), nullptr);
+			vkDestroyShaderModule(vkDevice, createShaderModule(vkDevice, resources->fragShaderCode), nullptr);
+		}
+
+		state.setBytesProcessed(state.getIterations() * (resources->vertShaderCode.size() + resources->fragShaderCode.size()));
+	});
+
+	/* PIPELINES */
+	// Drivers may keep their own cache on disk as well, e.g. Mesa's, set MESA_SHADER_CACHE_DISABLE=true for truly cold numbers
+	runner.add("pipeline/create_cold", [resources](BenchmarkState &state) {
+		while (state.keepRunning()) {
+			buildThroughVariantCache(*resources, {}, nullptr);
+		}
+	});
+
+	runner.add("pipeline/create_cached", [resources](BenchmarkState &state) {
+		while (state.keepRunning()) {
+			buildThroughVariantCache(*resources, resources->warmCacheData, nullptr);
+		}
+	});
+
+	/* RECORDING */
+	// CPU cost of recording a render pass with drawCount draws, nothing is submitted
+	for (uint32_t drawCount : { 1u, 64u, 1024u }) {
+		runner.add("record/draws/" + std::to_string(drawCount), [resources, drawCount](BenchmarkState &state) {
+			const BenchmarkDevice &device = *resources->device;
+			VkDevice vkDevice = device.getDevice();
+
+			Image color = createImage(device, SCENE_COLOR_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+			Image depth = createImage(device, SCENE_DEPTH_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+			Buffer vertexBuffer = createVertexBuffer(device, vertices.data(), sizeof(Vertex) * vertices.size());
+			ObjectInstance instance = { glm::vec4(0.0f, 0.0f, 0.5f, 1.0f) };
+			Buffer instanceBuffer = createVertexBuffer(device, &instance, sizeof(instance));
+			VkCommandBuffer commandBuffer = allocateCommandBuffer(device);
+
+			PipelineVariantCache cache;
+			cache.create(vkDevice, device.getPhysicalDevice(), resources->warmCacheData);
+			VkPipeline pipeline = cache.get("triangle", ShaderVariantKey{}, [&resources](const ShaderVariantKey &key, const VkSpecializationInfo *specializationInfo, VkPipelineCache pipelineCache) {
+				return buildTrianglePipeline(*resources, specializationInfo, pipelineCache);
+			});
+
+			std::array<VkBuffer, 2> vertexBuffers = { vertexBuffer.buffer, instanceBuffer.buffer };
+			std::array<VkDeviceSize, 2> vertexOffsets = { 0, 0 };
+
+			while (state.keepRunning()) {
+				vkResetCommandBuffer(commandBuffer, 0);
+
+				VkCommandBufferBeginInfo beginInfo{};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+				recordImageBarrier(commandBuffer, color.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+				recordImageBarrier(commandBuffer, depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+				VkRenderingAttachmentInfo colorAttachment{};
+				colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+				colorAttachment.imageView = color.view;
+				colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+				VkRenderingAttachmentInfo depthAttachment{};
+				depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+				depthAttachment.imageView = depth.view;
+				depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+				VkRenderingInfo renderingInfo{};
+				renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+				renderingInfo.renderArea = { { 0, 0 }, TARGET_EXTENT };
+				renderingInfo.layerCount = 1;
+				renderingInfo.colorAttachmentCount = 1;
+				renderingInfo.pColorAttachments = &colorAttachment;
+				renderingInfo.pDepthAttachment = &depthAttachment;
+
+				vkCmdBeginRendering(commandBuffer, &renderingInfo);
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+				VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(TARGET_EXTENT.width), static_cast<float>(TARGET_EXTENT.height), 0.0f, 1.0f };
+				VkRect2D scissor = { { 0, 0 }, TARGET_EXTENT };
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+				// Rebinding per draw is what a scene of separate meshes would do
+				for (uint32_t draw = 0; draw < drawCount; ++draw) {
+					vkCmdBindVertexBuffers(commandBuffer, 0, static_cast<uint32_t>(vertexBuffers.size()), vertexBuffers.data(), vertexOffsets.data());
+					vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+				}
+
+				vkCmdEndRendering(commandBuffer);
+				vkEndCommandBuffer(commandBuffer);
+			}
+
+			state.setItemsProcessed(state.getIterations() * drawCount);
+
+			cache.destroy();
+			vkFreeCommandBuffers(vkDevice, device.getCommandPool(), 1, &commandBuffer);
+			destroyBuffer(device, instanceBuffer);
+			destroyBuffer(device, vertexBuffer);
+			destroyImage(device, depth);
+			destroyImage(device, color);
+		});
+	}
+
+	/* SUBMISSION */
+	// Latency of an empty submission until the CPU sees it completed, the floor of any CPU-GPU round trip
+	runner.add("submit/fence_round_trip", [&device](BenchmarkState &state) {
+		VkDevice vkDevice = device.getDevice();
+		VkCommandBuffer commandBuffer = allocateCommandBuffer(device);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		if (vkCreateFence(vkDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create fence!");
+		}
+
+		VkCommandBufferSubmitInfo commandBufferInfo{};
+		commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferInfo.commandBuffer = commandBuffer;
+
+		VkSubmitInfo2 submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		submitInfo.commandBufferInfoCount = 1;
+		submitInfo.pCommandBufferInfos = &commandBufferInfo;
+
+		while (state.keepRunning()) {
+			vkQueueSubmit2(device.getQueue(), 1, &submitInfo, fence);
+			vkWaitForFences(vkDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+			vkResetFences(vkDevice, 1, &fence);
+		}
+
+		vkDestroyFence(vkDevice, fence, nullptr);
+		vkFreeCommandBuffers(vkDevice, device.getCommandPool(), 1, &commandBuffer);
+	});
+
+	// The same round trip through SubmissionScheduler, which is how VulkanApplication submits and waits on frames
+	runner.add("submit/timeline_round_trip", [&device](BenchmarkState &state) {
+		VkDevice vkDevice = device.getDevice();
+		VkCommandBuffer commandBuffer = allocateCommandBuffer(device);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		vkEndCommandBuffer(commandBuffer);
+
+		SubmissionScheduler scheduler;
+		scheduler.create(vkDevice);
+		uint32_t queue = scheduler.addQueue(device.getQueue(), "graphics");
+
+		SubmitBatch batch;
+		batch.commandBuffers.push_back(commandBuffer);
+
+		while (state.keepRunning()) {
+			TimelinePoint point = scheduler.submit(queue, batch);
+			scheduler.flush();
+			scheduler.wait(point);
+		}
+
+		scheduler.destroy();
+		vkFreeCommandBuffers(vkDevice, device.getCommandPool(), 1, &commandBuffer);
+	});
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+#include "Benchmark.hpp"
+#include "BenchmarkDevice.hpp"
+
+// Setup paths and per-frame primitives of VulkanApplication, measured in isolation on a headless device
+// shaderDirectory holds the compiled SPIR-V, see shaders/compile.bat
+void registerVulkanBenchmarks(BenchmarkRunner &runner, BenchmarkDevice &device, const std::string &shaderDirectory);
@@ -0,0 +1,86 @@
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "Benchmark.hpp"
+#include "BenchmarkDevice.hpp"
+#include "VulkanBenchmarks.hpp"
+#include "TransformBenchmarks.hpp"
+
+// --json <file> writes the results in Google Benchmark's JSON format, --filter <text> only runs benchmarks whose name contains it
+// --min-time <seconds> is how long every benchmark runs for at least
+// --device <name> picks the device whose name contains it, e.g. llvmpipe for lavapipe
+// --shaders <directory> is where the compiled SPIR-V is, shaders by default
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    std::string deviceName;
+    std::string shaderDirectory = "shaders";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        }
+        else if (argument == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        }
+        else if (argument == "--min-time" && hasValue) {
+            std::string value = argv[++i];
+            double seconds = 0.0;
+            try {
+                seconds = std::stod(value);
+            }
+            catch (const std::logic_error&) {
+                // std::invalid_argument and std::out_of_range, neither says which argument was wrong
+            }
+
+            if (!std::isfinite(seconds) || seconds <= 0.0) {
+                std::cerr << "invalid --min-time " << value << ", expected a number of seconds greater than 0" << std::endl;
+                return EXIT_FAILURE;
+            }
+            options.minTime = seconds;
+        }
+        else if (argument == "--device" && hasValue) {
+            deviceName = argv[++i];
+        }
+        else if (argument == "--shaders" && hasValue) {
+            shaderDirectory = argv[++i];
+        }
+        else {
+            // Also reached by an option missing its value, running with a setting other than the one asked for would be misleading
+            std::cerr << "unknown argument " << argument << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    BenchmarkDevice device;
+    bool succeeded = false;
+
+    try {
+        device.create(deviceName);
+        std::cout << "device: " << device.getDeviceDescription() << ", driver: " << device.getDriverDescription() << std::endl;
+
+        // The registered benchmarks hold on to resources of the device, so the runner has to be gone before it's destroyed
+        {
+            BenchmarkRunner runner;
+            runner.setContext("vulkan_device", device.getDeviceDescription());
+            runner.setContext("vulkan_driver", device.getDriverDescription());
+
+            registerVulkanBenchmarks(runner, device, shaderDirectory);
+            registerTransformBenchmarks(runner);
+            succeeded = runner.run(options);
+        }
+
+        device.destroy();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -1,11 +1,81 @@
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
 #include "VulkanApplication.hpp"
 
+// --capture <directory> writes every frame as a PPM image, --capture-y4m <directory> as a single Y4M video
+// --headless <frames> renders that many frames without a window and exits, combine it with --capture to record them
+// --gpu-budget <milliseconds> sets the GPU frame time the render resolution is scaled to fit in
+// --no-async-compute keeps post processing on the graphics queue
+// --no-depth-prepass draws the scene without laying down depth first, --no-occlusion-culling only culls objects outside of the view
+// --no-host-allocator leaves host memory to the driver instead of tracking it
+// --hud starts with the performance HUD shown, F1 toggles it at any time
+// F2, F3 and F4 switch the scene shader between its variants, see VulkanApplication's SHADER VARIANTS
 int main(int argc, char** argv) {
     VulkanApplication app;
 
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--capture" && hasValue) {
+            app.enableCapture(argv[++i], FrameCapture::OutputFormat::PpmSequence);
+        }
+        else if (argument == "--capture-y4m" && hasValue) {
+            app.enableCapture(argv[++i], FrameCapture::OutputFormat::Y4mStream);
+        }
+        else if (argument == "--headless" && hasValue) {
+            std::string value = argv[++i];
+            unsigned long frames = 0;
+            try {
+                frames = std::stoul(value);
+            }
+            catch (const std::logic_error&) {
+                // Left at 0, reported below
+            }
+
+            if (frames == 0 || frames > UINT32_MAX || value.find('-') != std::string::npos) {
+                std::cerr << "invalid --headless " << value << ", expected a number of frames greater than 0" << std::endl;
+                return EXIT_FAILURE;
+            }
+            app.enableHeadless(static_cast<uint32_t>(frames));
+        }
+        else if (argument == "--gpu-budget" && hasValue) {
+            std::string value = argv[++i];
+            double milliseconds = 0.0;
+            try {
+                milliseconds = std::stod(value);
+            }
+            catch (const std::logic_error&) {
+                // std::invalid_argument and std::out_of_range, neither says which argument was wrong
+            }
+
+            if (!std::isfinite(milliseconds) || milliseconds <= 0.0) {
+                std::cerr << "invalid --gpu-budget " << value << ", expected a number of milliseconds greater than 0" << std::endl;
+                return EXIT_FAILURE;
+            }
+            app.setGpuFrameBudget(milliseconds);
+        }
+        else if (argument == "--no-async-compute") {
+            app.disableAsyncCompute();
+        }
+        else if (argument == "--no-depth-prepass") {
+            app.disableDepthPrepass();
+        }
+        else if (argument == "--no-occlusion-culling") {
+            app.disableOcclusionCulling();
+        }
+        else if (argument == "--no-host-allocator") {
+            app.disableHostAllocator();
+        }
+        else if (argument == "--hud") {
+            app.showHud();
+        }
+    }
+
     try {
         app.run();
     }
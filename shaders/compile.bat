@@ -1,3 +1,13 @@
 C:\VulkanSDK\1.3.296.0\Bin\glslc.exe shader.vert -o vert.spv
 C:\VulkanSDK\1.3.296.0\Bin\glslc.exe shader.frag -o frag.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe luminance_histogram.comp -o luminance_histogram.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe exposure.comp -o exposure.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe --target-env=vulkan1.1 -DUSE_SUBGROUPS exposure.comp -o exposure_subgroup.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe bloom_downsample.comp -o bloom_downsample.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe bloom_upsample.comp -o bloom_upsample.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe tonemap.comp -o tonemap.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe hiz_build.comp -o hiz_build.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe occlusion_cull.comp -o occlusion_cull.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe hud.vert -o hud_vert.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe hud.frag -o hud_frag.spv
 pause
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 450
+
+// Coverage of the glyphs, quads sample a texel that is always covered
+layout(binding = 0) uniform sampler2D fontAtlas;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	outColor = vec4(fragColor.rgb, fragColor.a * texture(fontAtlas, fragTexCoord).r);
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 450
+
+// Built on the CPU every frame in pixels from the top left, see PerformanceHud::Vertex
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec4 inColor;
+
+layout(push_constant) uniform PushConstants {
+	vec2 pixelToClip; // 2 / size of the swap chain image
+} pushConstants;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+	gl_Position = vec4(inPosition * pushConstants.pixelToClip - 1.0, 0.0, 1.0);
+	fragTexCoord = inTexCoord;
+	fragColor = inColor;
+}
\ No newline at end of file
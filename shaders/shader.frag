@@ -1,9 +1,32 @@
 #version 450
 
+// Specialization constants, their values are decided when the pipeline is created (see TriangleShaderConstant)
+// The driver constant folds them, so disabled features cost nothing at runtime
+layout(constant_id = 0) const uint featureBits = 0;
+layout(constant_id = 1) const uint contrastIterations = 0;
+
+const uint FEATURE_GRAYSCALE = 1u << 0;
+const uint FEATURE_INVERT = 1u << 1;
+
 // layout(location = 0) specifies which framebuffer to modify
 layout(location = 0) in vec3 fragColor;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-	outColor = vec4(fragColor, 1.0);
+	vec3 color = fragColor;
+
+	// Loop count is known at pipeline creation, so the loop is fully unrolled
+	for (uint i = 0; i < contrastIterations; ++i) {
+		color = color * color * (3.0 - 2.0 * color);
+	}
+
+	if ((featureBits & FEATURE_GRAYSCALE) != 0u) {
+		color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+	}
+
+	if ((featureBits & FEATURE_INVERT) != 0u) {
+		color = vec3(1.0) - color;
+	}
+
+	outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -1,20 +1,18 @@
 #version 450
 
-vec3 colors[3] = vec3[](
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0)
-);
+// Vertex attributes are streamed from the per-frame allocator, see Vertex::getAttributeDescriptions
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
 
-vec2 positions[3] = vec2[](
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+// Per instance, only the objects that survived occlusion culling, see ObjectInstance
+layout(location = 2) in vec4 inPositionScale;
 
 layout(location = 0) out vec3 fragColor;
 
+// The depth pre-pass and the color pass have to produce bit identical depth for the EQUAL depth test
+invariant gl_Position;
+
 void main() {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	gl_Position = vec4(inPosition * inPositionScale.w + inPositionScale.xy, inPositionScale.z, 1.0);
+	fragColor = inColor;
 }
\ No newline at end of file